@@ -412,6 +412,7 @@ BENCHMARK(BM_mthread_query_x_points_LSHForest)
   ->Unit(benchmark::kMillisecond)
   ->Args({0, 10, 90, 860, 535})
   ->Args({1, 10, 90, 860, 535})
+  ->Args({0, 100, 90, 860, 535})
   // ->Args({2, 10, 90, 860, 535})
   ->UseManualTime();
   
\ No newline at end of file
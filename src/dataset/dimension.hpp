@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "../global.hpp"
+
+// Sketch widths in bits that a binary is compiled for, every index type is instantiated once per width
+constexpr std::array<ui32, 3> SKETCH_DIMENSIONS = { 256, 512, 1024 };
+
+/**
+ * @brief Calls @fn with a std::integral_constant holding @dimensions, such that code templated on the
+ *        dimension of the points is selected at runtime from the width of the loaded sketches.
+ *        Every dimension in SKETCH_DIMENSIONS is instantiated in the calling binary.
+ * @param dimensions Number of bits in a sketch
+ * @returns The value returned by @fn, which must return the same type for every dimension
+ * @throws std::invalid_argument if @dimensions is not in SKETCH_DIMENSIONS
+ */
+template<ui32 I = 0, typename Fn>
+inline auto dispatch_dimension(ui32 dimensions, Fn&& fn) {
+  constexpr ui32 DIM = SKETCH_DIMENSIONS[I];
+  if (dimensions == DIM) return fn(std::integral_constant<ui32, DIM>());
+
+  if constexpr (I + 1 < SKETCH_DIMENSIONS.size()) {
+    return dispatch_dimension<I + 1>(dimensions, std::forward<Fn>(fn));
+  } else {
+    throw std::invalid_argument("Unsupported sketch dimension: " + std::to_string(dimensions));
+  }
+}
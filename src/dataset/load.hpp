@@ -4,6 +4,7 @@
 #include "../index/point.hpp"
 
 #include "./dataset.hpp"
+#include "./dimension.hpp"
 
 #include <H5Cpp.h>
 #include <sstream>
@@ -53,6 +54,12 @@ inline static std::pair<int, int> get_dataset_dimensions(H5::DataSet &dataset)
   return {(int)data_dims_out[0], (int)data_dims_out[1]};
 }
 
+/** @returns The number of bits in the sketches of a dataset of 64-bit words */
+inline static ui32 get_sketch_dimensions(H5::DataSet dataset)
+{
+  return get_dataset_dimensions(dataset).second * 64;
+}
+
 inline static H5::DataSet fetch_local_dataset(
   DataSize size, 
   std::string filePath, 
@@ -85,16 +92,11 @@ template<ui32 D>
 inline static PointsDataset<D> parse_points_dataset(std::vector<ui64> &in, const int rows, const int cols)
 {
   PointsDataset<D> src;
+  src.reserve(rows);
 
-  assert(D / cols == 64);
+  assert((ui64) cols * 64 == D); // every row holds the D bits of a sketch in 64-bit words
   for (int r = 0; r < rows; ++r) {
-    std::stringstream ss;
-
-    for (int c = 0; c < cols; ++c) {
-      ss << std::bitset<64>(in[r * cols + c]);
-    }
-    
-    src.emplace_back(ss.str()); // construct point from bitstring
+    src.push_back(Point<D>::from_words(std::span<const ui64>(&in[(ui64) r * cols], cols)));
   }
 
   assert(src.size() == rows);
@@ -115,6 +117,27 @@ inline static PointsDataset<D> parse_hdf5_points(H5::DataSet dataset) {
   return parse_points_dataset<D>(data_output, rows, cols);
 }
 
+/**
+ * @brief Reads the sketches of @dataset into consecutive Point<D>::words(), which a PointStore<D> can borrow
+ *        without copying. The rows of the datasets hold the most significant word first, as read by
+ *        Point<D>::from_words, so the words of every row are reversed in place.
+ */
+template<ui32 D>
+inline static std::vector<ui64> parse_hdf5_words(H5::DataSet dataset) {
+  static_assert(Point<D>::HAS_WORDS);
+  auto [rows, cols] = get_dataset_dimensions(dataset);
+  assert((ui64) cols * 64 == D);
+
+  std::vector<ui64> words((ui64) rows * cols);
+  dataset.read(words.data(), H5::PredType::NATIVE_UINT64);
+  dataset.close();
+
+  for (ui64 r = 0; r < (ui64) rows; ++r) {
+    std::reverse(words.begin() + r * cols, words.begin() + (r + 1) * cols);
+  }
+  return words;
+}
+
 inline static std::vector<std::vector<ui32>> parse_hdf5_answers(H5::DataSet dataset)
 {
   auto [rows, cols] = get_dataset_dimensions(dataset);
@@ -19,6 +19,7 @@
 #define ALL(o) (o).begin(), (o).end()
 #define hmap std::unordered_map
 
+typedef uint16_t ui16;
 typedef uint32_t ui32;
 typedef uint64_t ui64;
 
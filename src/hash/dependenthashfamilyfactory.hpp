@@ -33,7 +33,10 @@ public:
       const ui32 t = p1.distance(*(sample_beg + (N>>1))); 
       HF.push_back([p1, t](const Point<D> &p2) -> bool {
         return p1.distance(p2) < t;
-      });
+      }, { UINT32_MAX, [p1, t](const Point<D> &p2) {
+        const float d = p1.distance(p2);
+        return d < t ? t - d : t - d - 1.0f;
+      } });
     }
     return HF;
   }
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cmath>
+#include <mutex>
+
+#include "../global.hpp"
+#include "../index/point.hpp"
+#include "../util/threadpool.hpp"
+#include "hashfamily.hpp"
+
+/**
+ * @brief Estimated probability of each dimension of a sketch differing between a query and its
+ *        true near neighbours. Single-bit hashes have no per-query margin, so the flip rate of the
+ *        dimension they read is used as their flip score instead, which orders the probe sequence of
+ *        a map by the joint probability of the bits it flips.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class FlipModel {
+  // rates[d] : probability of dimension d differing between a query and a near neighbour
+  std::vector<float> rates;
+
+public:
+  // Rates are clamped to [MIN_RATE, MAX_RATE], such that every score is finite and positive,
+  // since a zero margin would lose the sign of the hash
+  static constexpr float MIN_RATE = 1e-4f, MAX_RATE = 0.499f;
+
+  FlipModel() : rates(D, MAX_RATE) {}
+
+  explicit FlipModel(std::vector<float> rates) : rates(std::move(rates)) {
+    assert(this->rates.size() == D);
+    for (auto& r : this->rates) r = std::clamp(r, MIN_RATE, MAX_RATE);
+  }
+
+  inline float rate(ui32 dim) const noexcept { return rates[dim]; }
+
+  /**
+   * @returns The flip score of dimension @dim, the negative log-odds of the dimension flipping.
+   *          The sum of the scores of a set of bits ranks the sets by the joint probability
+   *          that exactly those bits flip, assuming independent dimensions.
+   */
+  inline float score(ui32 dim) const noexcept { return -std::log(rates[dim] / (1.0f - rates[dim])); }
+
+  /**
+   * @brief Estimates the flip rates from queries with known ground truth. The near neighbours of
+   *        queries[q] are the points within distance answers[q][k-1] of it, found by brute force.
+   *        Rates are Laplace smoothed, such that dimensions that never flip keep a small rate.
+   * @param answers answers[q] : the hamming distances of the true nearest neighbours of queries[q]
+   *                in ascending order, as stored in the answers of the benchmark datasets
+   * @param k Number of nearest neighbours to train on
+   */
+  static FlipModel<D> fit(std::span<const Point<D>> points,
+                          const std::vector<Point<D>>& queries,
+                          const std::vector<std::vector<ui32>>& answers,
+                          ui32 k)
+  {
+    assert(queries.size() == answers.size() && k > 0);
+    std::vector<ui64> flips(D, 0);
+    ui64 pairs = 0;
+    std::mutex mtx;
+
+    ThreadPool::instance().parallel_for(0, queries.size(), 1, [&](ui32 q) {
+      assert(answers[q].size() >= k);
+      const ui32 radius = answers[q][k-1];
+      std::vector<ui64> local(D, 0);
+      ui64 local_pairs = 0;
+      for (const auto& p : points) {
+        const auto diff = queries[q] ^ p;
+        if (diff.count() > radius) continue;
+        ++local_pairs;
+        for (ui32 d = diff._Find_first(); d < D; d = diff._Find_next(d)) ++local[d];
+      }
+
+      std::lock_guard<std::mutex> lock(mtx);
+      pairs += local_pairs;
+      for (ui32 d = 0; d < D; ++d) flips[d] += local[d];
+    });
+
+    std::vector<float> rates(D);
+    for (ui32 d = 0; d < D; ++d) {
+      rates[d] = (flips[d] + 1.0) / (pairs + 2.0);
+    }
+    return FlipModel<D>(std::move(rates));
+  }
+
+  /**
+   * @brief Replaces the margins of the single-bit hashes of @hf by margins whose magnitude
+   *        is the flip score of the dimension they read. Other hashes keep their margins.
+   */
+  void apply(HashFamily<D>& hf) const {
+    for (ui32 i = 0; i < hf.size(); ++i) {
+      const ui32 dim = hf.info(i).dim;
+      if (dim >= D) continue;
+      const float s = this->score(dim);
+      hf.set_info(i, { dim, [dim, s](const Point<D>& p) { return p[dim] ? s : -s; } });
+    }
+  }
+};
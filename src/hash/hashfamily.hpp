@@ -1,4 +1,5 @@
 #pragma once
+#include <cmath>
 #include <iostream>
 #include <vector>
 #include <functional>
@@ -9,19 +10,91 @@
 template<ui32 D>
 using BinaryHash = std::function<bool(const Point<D>&)>;
 
+/**
+ * @brief The signed margin of a point to the decision boundary of a binary hash. 
+ *        The sign is the value of the hash (positive for true), and the magnitude is 
+ *        the number of bits of the point that must flip for the hash to flip.
+ */
+template<ui32 D>
+using HashMargin = std::function<float(const Point<D>&)>;
+
+/**
+ * @brief Metadata of a binary hash function
+ */
+template<ui32 D>
+struct HashInfo {
+  ui32 dim = UINT32_MAX;  // The dimension read by a single-bit hash, UINT32_MAX for other hashes
+  HashMargin<D> margin;   // The signed margin of the hash, empty if unknown
+};
+
 /**
  * D dimensional Point hash family
  */
 template <ui32 D>
 class HashFamily : public std::vector<BinaryHash<D>> {
+  // infos[i] : metadata of the i'th hash function. Hash functions added through the 
+  // std::vector interface carry no metadata, in which case infos is shorter than the family.
+  std::vector<HashInfo<D>> infos;
+
 public:
   using std::vector<BinaryHash<D>>::vector;
-  
+  using std::vector<BinaryHash<D>>::push_back;
+
+  /**
+   * @brief Appends the hash function @h with the metadata @info
+   */
+  void push_back(BinaryHash<D> h, HashInfo<D> info) {
+    infos.resize(this->size());
+    std::vector<BinaryHash<D>>::push_back(std::move(h));
+    infos.push_back(std::move(info));
+  }
+
+  /**
+   * @returns The metadata of the @i'th hash function
+   */
+  const HashInfo<D>& info(ui32 i) const noexcept {
+    static const HashInfo<D> none;
+    return i < infos.size() ? infos[i] : none;
+  }
+
+  /**
+   * @brief Replaces the metadata of the @i'th hash function by @info
+   */
+  void set_info(ui32 i, HashInfo<D> info) {
+    assert(i < this->size());
+    infos.resize(std::max((ui32) infos.size(), i + 1));
+    infos[i] = std::move(info);
+  }
+
+  /**
+   * @returns True if the margin of every hash function in the family is known
+   */
+  bool has_margins() const noexcept {
+    return infos.size() >= this->size() 
+        && std::all_of(infos.begin(), infos.begin() + this->size(), [](const auto& info) { return (bool) info.margin; });
+  }
+
   HashFamily& operator+=(const HashFamily& rhs) {
+    infos.resize(this->size());
     this->insert(this->end(), ALL(rhs));
+    for (ui32 i = 0; i < rhs.size(); ++i) {
+      infos.push_back(rhs.info(i));
+    }
     return *this;
   }
 
+  /**
+   * @returns A hash family containing the hash functions [@beg, @end) of this, and their metadata
+   */
+  HashFamily<D> slice(ui32 beg, ui32 end) const {
+    assert(beg <= end && end <= this->size());
+    HashFamily<D> ret;
+    for (ui32 i = beg; i < end; ++i) {
+      ret.push_back((*this)[i], this->info(i));
+    }
+    return ret;
+  }
+
   /**
    * @brief Compute the mean of this hash family on the given input points
    *        The mean is defined as the average fraction of 
@@ -107,6 +180,25 @@ public:
       ret |= ((ui64) (*this)[i](p)) << i;
     return ret;
   }
+
+  /**
+   * @brief Apply all hashes in chain through their margins, such that the hash and 
+   *        the flip scores of its bits are computed in a single pass. Requires has_margins().
+   * @param flips flips[i] : the number of bits of @p that must flip for the i'th hash to flip
+   * @returns The same hash as operator()
+   */
+  ui64 hash_with_margins(const Point<D>& p, std::vector<float>& flips) const {
+    assert(this->size() <= 64 && this->has_margins());
+    const ui64 depth = this->size();
+    flips.resize(depth);
+    ui64 ret = 0x0;
+    for (ui64 i = 0; i < depth; ++i) {
+      const float margin = infos[i].margin(p);
+      ret |= ((ui64) (margin > 0)) << i;
+      flips[i] = std::abs(margin);
+    }
+    return ret;
+  }
   
   //! TO:DO consider changing to std::sample
   /**
@@ -125,7 +217,7 @@ public:
     // Select subset
     HashFamily<D> ret;
     for (ui32 i = 0; i < depth; ++i) {
-      ret.push_back((*this)[indices[i]]);
+      ret.push_back((*this)[indices[i]], this->info(indices[i]));
     }
     return ret;
   }
@@ -163,6 +255,7 @@ public:
     this->resize(sz);
     for (ui32 i = 0; i < sz; ++i)
       (*this)[i] = res[i];
+    infos.clear(); // the merged hashes carry no metadata
   }
 };
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <limits>
 #include <random>
 #include "hashfamily.hpp"
 #include "hashtype.hpp"
@@ -12,7 +13,8 @@ public:
     for (ui32 i = 0; i < size; ++i) {
       ui32 bit = rand() % D;
       HF.push_back([bit](const Point<D> &p)
-                   { return p[bit]; });
+                   { return p[bit]; }, 
+                   bit_info(bit));
     }
     return HF;
   }
@@ -29,7 +31,8 @@ public:
     {
       HashFamily<D> base = getDimensionBits().subset(1);
       HF.push_back([base](const Point<D> &p)
-                   { return base[0](p); });
+                   { return base[0](p); },
+                   base.info(0));
     }
     return HF;
   }
@@ -39,7 +42,13 @@ public:
     for (ui32 i = 0; i < size; ++i) {
       auto mask = Point<D>::random(distribution_factor);
       HF.push_back([mask](const Point<D> &p)
-                   { return (p & mask) == mask; });
+                   { return (p & mask) == mask; },
+                   { UINT32_MAX, [mask](const Point<D> &p) {
+                     // True: any set bit of the mask may be cleared, False: all missing bits must be set
+                     const float missing = (mask & ~p).count();
+                     if (missing > 0) return -missing;
+                     return mask.any() ? 1.0f : std::numeric_limits<float>::infinity();
+                   } });
     }
     return HF;
   }
@@ -53,7 +62,8 @@ public:
     {
       auto point = Point<D>::random(distribution_factor);
       HF.push_back([point, threshold](const Point<D> &p)
-                   { return p.distance(point) <= threshold; });
+                   { return p.distance(point) <= threshold; },
+                   hdist_info(point, threshold));
     }
     
     return HF;
@@ -68,7 +78,8 @@ public:
       
       ui32 L = rand() % (D / fraction);
       HF.push_back([point, L](const Point<D> &p)
-                   { return p.distance(point) <= L; });
+                   { return p.distance(point) <= L; },
+                   hdist_info(point, L));
     }
     
     return HF;
@@ -100,6 +111,23 @@ public:
   }
 
 private:
+  /**
+   * @returns Metadata of the hash returning bit @bit of a point, a single flip of the bit flips the hash
+   */
+  static HashInfo<D> bit_info(ui32 bit) {
+    return { bit, [bit](const Point<D> &p) { return p[bit] ? 1.0f : -1.0f; } };
+  }
+
+  /**
+   * @returns Metadata of the hash returning whether a point is within hamming distance @L of @point
+   */
+  static HashInfo<D> hdist_info(const Point<D>& point, ui32 L) {
+    return { UINT32_MAX, [point, L](const Point<D> &p) {
+      const float d = p.distance(point);
+      return d <= L ? L - d + 1.0f : L - d;
+    } };
+  }
+
   inline static HashFamily<D> *baseFam = new HashFamily<D>();
   static HashFamily<D> getDimensionBits() {
     if (baseFam->size() != 0) {
@@ -108,7 +136,8 @@ private:
 
     for (ui32 i = 0; i < D; ++i) {
       baseFam->push_back([i](const Point<D> &p)
-                   { return p[i]; });
+                   { return p[i]; },
+                   bit_info(i));
     }
 
     return *baseFam;
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cmath>
+#include <random>
+
+#include "hashfamily.hpp"
+#include "../util/threadpool.hpp"
+
+/**
+ * @brief For constructing hash families from known near neighbour pairs.
+ *        Chains are grown greedily from a pool of candidate hashes, such that each chain keeps as many
+ *        (query, neighbour) pairs in a shared bucket as possible while splitting a sample of the points
+ *        into balanced buckets. This is the greedy version of minimizing the ρ = log p1 / log p2 of a chain,
+ *        where p1 is the collision probability of neighbours and p2 of random points.
+ */
+template<ui32 D>
+class SupervisedHashFamilyFactory {
+public:
+  using PointPair = std::pair<Point<D>, Point<D>>;
+
+  // Weight of a pair once an earlier chain places it in a shared bucket, such that later chains favour
+  // the pairs that are still separated
+  static constexpr double COVERED_WEIGHT = 0.5;
+
+  // Factor applied to the score of a hash for every earlier chain that uses it, such that chains differ
+  // even when the earlier chains cover every pair
+  static constexpr double REUSED_WEIGHT = 0.75;
+
+  // Default weight of the balance term, 1 ranks the hashes by log p1 - log p2 of the grown chain
+  static constexpr double DEFAULT_BALANCE = 1.0;
+
+  /**
+   * @brief Returns the pairs of every query and the points within distance answers[q][k-1] of it, found by brute force
+   * @param answers answers[q] : the hamming distances of the true nearest neighbours of queries[q]
+   *                in ascending order, as stored in the answers of the benchmark datasets
+   */
+  static std::vector<PointPair> knn_pairs(const std::vector<Point<D>>& points,
+                                          const std::vector<Point<D>>& queries,
+                                          const std::vector<std::vector<ui32>>& answers,
+                                          ui32 k)
+  {
+    assert(queries.size() == answers.size() && k > 0);
+    std::vector<std::vector<PointPair>> found(queries.size());
+    ThreadPool::instance().parallel_for(0, queries.size(), 1, [&](ui32 q) {
+      assert(answers[q].size() >= k);
+      for (const auto& p : points) {
+        if (queries[q].distance(p) <= answers[q][k-1]) found[q].emplace_back(queries[q], p);
+      }
+    });
+    return flatten(found);
+  }
+
+  /**
+   * @brief Returns the pairs of @sample_size points drawn at random from @points and their @k nearest
+   *        other points, found by brute force. Used when no ground truth is available.
+   */
+  static std::vector<PointPair> knn_pairs(const std::vector<Point<D>>& points, ui32 sample_size, ui32 k) {
+    assert(k < points.size());
+    std::vector<ui32> sample(points.size());
+    std::iota(ALL(sample), 0);
+    std::shuffle(ALL(sample), std::mt19937(std::random_device()()));
+    sample.resize(std::min(sample_size, (ui32) points.size()));
+
+    std::vector<std::vector<PointPair>> found(sample.size());
+    ThreadPool::instance().parallel_for(0, sample.size(), 1, [&](ui32 q) {
+      const Point<D>& query = points[sample[q]];
+      std::vector<std::pair<ui32, ui32>> dists; // (distance, point index)
+      dists.reserve(points.size() - 1);
+      for (ui32 i = 0; i < points.size(); ++i) {
+        if (i != sample[q]) dists.emplace_back(query.distance(points[i]), i);
+      }
+      std::partial_sort(dists.begin(), dists.begin() + k, dists.end());
+      for (ui32 i = 0; i < k; ++i) found[q].emplace_back(query, points[dists[i].second]);
+    });
+    return flatten(found);
+  }
+
+  /**
+   * @brief Grows @count chains of @depth hash functions chosen from @pool.
+   *        Each step adds the hash of @pool that maximizes log p1 - @balance * log p2 of the chain, where
+   *        p1 is the weighted fraction of @pairs sharing a bucket and p2 the probability of two points
+   *        of @sample sharing a bucket. Pairs covered by a chain are down-weighted for the next chains,
+   *        and the hashes it uses are penalized for them.
+   * @param sample A sample of the points to index, used to estimate the bucket balance
+   * @param pairs (query, near neighbour) pairs, see knn_pairs
+   * @param balance Weight of the balance term, 0 ignores balance
+   * @returns A family of @count * @depth hash functions, where chain i is the slice [i * @depth, (i+1) * @depth)
+   */
+  static HashFamily<D> create(const std::vector<Point<D>>& sample,
+                              const std::vector<PointPair>& pairs,
+                              const HashFamily<D>& pool,
+                              ui32 depth,
+                              ui32 count,
+                              double balance = DEFAULT_BALANCE)
+  {
+    const ui32 S = sample.size(), P = pairs.size(), C = pool.size();
+    assert(S > 0 && depth <= C);
+
+    // value[c][s] : pool[c] applied to sample[s], agree[c][p] : true if pool[c] hashes both points of pairs[p] alike
+    std::vector<std::vector<bool>> value(C, std::vector<bool>(S)), agree(C, std::vector<bool>(P));
+    ThreadPool::instance().parallel_for(0, C, 1, [&](ui32 c) {
+      for (ui32 s = 0; s < S; ++s) value[c][s] = pool[c](sample[s]);
+      for (ui32 p = 0; p < P; ++p) agree[c][p] = pool[c](pairs[p].first) == pool[c](pairs[p].second);
+    });
+
+    HashFamily<D> ret;
+    std::vector<double> weight(P, 1.0), score(C);
+    std::vector<ui32> uses(C, 0); // uses[c] : number of earlier chains containing pool[c]
+    for (ui32 m = 0; m < count; ++m)
+    {
+      // group[s] : bucket of sample[s] in the chain so far, numbered [0, G)
+      std::vector<ui32> group(S, 0);
+      ui32 G = 1;
+      std::vector<bool> alive(P, true), used(C, false);
+
+      for (ui32 d = 0; d < depth; ++d)
+      {
+        ThreadPool::instance().parallel_for(0, C, 1, [&](ui32 c) {
+          if (used[c]) { score[c] = -INFINITY; return; }
+
+          double w = 0.0;
+          for (ui32 p = 0; p < P; ++p) {
+            if (alive[p] && agree[c][p]) w += weight[p];
+          }
+
+          std::vector<ui32> cnt(2 * G, 0);
+          for (ui32 s = 0; s < S; ++s) ++cnt[2 * group[s] + value[c][s]];
+          double collisions = 0.0;
+          for (auto n : cnt) collisions += (double) n * n;
+
+          score[c] = std::log(w + 1.0) + uses[c] * std::log(REUSED_WEIGHT)
+                   - balance * std::log(collisions / ((double) S * S));
+        });
+
+        const ui32 best = std::max_element(ALL(score)) - score.begin();
+        used[best] = true;
+        ++uses[best];
+        ret.push_back(pool[best], pool.info(best));
+
+        for (ui32 p = 0; p < P; ++p) alive[p] = alive[p] && agree[best][p];
+
+        // Renumber the buckets split by pool[best]
+        std::vector<ui32> label(2 * G, UINT32_MAX);
+        G = 0;
+        for (ui32 s = 0; s < S; ++s) {
+          ui32& l = label[2 * group[s] + value[best][s]];
+          if (l == UINT32_MAX) l = G++;
+          group[s] = l;
+        }
+      }
+
+      for (ui32 p = 0; p < P; ++p) {
+        if (alive[p]) weight[p] *= COVERED_WEIGHT;
+      }
+    }
+
+    return ret;
+  }
+
+private:
+  static std::vector<PointPair> flatten(const std::vector<std::vector<PointPair>>& found) {
+    std::vector<PointPair> ret;
+    for (const auto& f : found) ret.insert(ret.end(), ALL(f));
+    return ret;
+  }
+};
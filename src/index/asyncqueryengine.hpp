@@ -0,0 +1,226 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+
+#include "lshforest.hpp"
+
+/**
+ * @brief Configuration of an AsyncQueryEngine
+ */
+struct AsyncQueryConfig {
+  ui32 k = 10;                               // Number of nearest neighbors to find for each query
+  float recall = 0.9;                        // The precision of the queries
+  ui32 queue_capacity = 4096;                // Maximum number of pending queries before submissions block
+  ui32 max_batch = 1024;                     // Maximum number of queries answered in a single batch
+  std::chrono::microseconds max_delay{500};  // Maximum time a query waits for its batch to fill up
+};
+
+/**
+ * @brief Asynchronous front-end of an LSHForest. Queries are submitted as they arrive
+ *        and their results are delivered through futures or completion callbacks.
+ *
+ *        A dispatcher thread collects pending queries into batches answered by LSHForest::batch_query.
+ *        A batch is dispatched once it reaches the current target size, or when its oldest query has
+ *        waited for max_delay. The target grows while batches fill up before the deadline and shrinks
+ *        when they do not, such that batches are large under load and latency stays low otherwise.
+ *        The queue of pending queries is bounded, submit blocks while it is full and try_submit fails.
+ *        Errors never stop the dispatcher. If answering a batch throws, the error is stored in the futures of its 
+ *        queries, and errors of callback queries, including those thrown by the callbacks, are kept for take_error.
+ */
+template<ui32 D>
+class AsyncQueryEngine {
+public:
+  using Callback = std::function<void(std::vector<ui32>)>;
+
+private:
+  struct Request {
+    Point<D> query{};
+    std::promise<std::vector<ui32>> promise{};
+    Callback callback{}; // If set, the result is delivered through the callback instead of the promise
+    std::chrono::steady_clock::time_point arrival{};
+  };
+
+  LSHForest<D>& index;
+  const AsyncQueryConfig config;
+
+  std::deque<Request> requests;
+  mutable std::mutex mtx;
+  std::condition_variable not_empty, not_full;
+  bool stopping = false;
+
+  // The number of queries the dispatcher currently waits for before dispatching a batch
+  ui32 target_batch = 1;
+
+  // The first error of a callback query not yet taken by take_error
+  std::exception_ptr callback_error;
+
+  std::thread dispatcher;
+
+  /**
+   * @brief Enqueues @req, blocking while the queue is full unless @block is false
+   * @returns False if the request was not enqueued
+   */
+  bool enqueue(Request&& req, bool block) {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      if (block) {
+        not_full.wait(lock, [this] { return stopping || requests.size() < config.queue_capacity; });
+      }
+      if (stopping || requests.size() >= config.queue_capacity) return false;
+
+      req.arrival = std::chrono::steady_clock::now();
+      requests.push_back(std::move(req));
+    }
+    not_empty.notify_one();
+    return true;
+  }
+
+  /**
+   * @brief Delivers the error @err to the future of @req, or keeps it for take_error if @req has a callback
+   */
+  void fail(Request& req, std::exception_ptr err) {
+    if (!req.callback) {
+      req.promise.set_exception(err);
+      return;
+    }
+    std::unique_lock<std::mutex> lock(mtx);
+    if (!callback_error) callback_error = err;
+  }
+
+  void dispatch() {
+    std::vector<Request> batch;
+    std::vector<Point<D>> queries;
+
+    while (true) {
+      {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return stopping || !requests.empty(); });
+        if (requests.empty()) return; // stopping and drained
+
+        // Wait for the batch to fill up, or for the oldest query to reach its deadline
+        const auto deadline = requests.front().arrival + config.max_delay;
+        const bool filled = not_empty.wait_until(lock, deadline, [this] {
+          return stopping || requests.size() >= target_batch;
+        });
+
+        // Adapt the batch size to the load
+        target_batch = filled ? std::min(target_batch << 1, config.max_batch)
+                              : std::max(target_batch >> 1, 1U);
+
+        const ui32 n = std::min((ui32) requests.size(), config.max_batch);
+        for (ui32 i = 0; i < n; ++i) {
+          batch.push_back(std::move(requests.front()));
+          requests.pop_front();
+        }
+      }
+      not_full.notify_all();
+
+      for (auto& req : batch) {
+        queries.push_back(req.query);
+      }
+
+      std::vector<std::vector<ui32>> results;
+      try {
+        results = index.batch_query(queries, config.k, config.recall);
+      } catch (...) {
+        const std::exception_ptr err = std::current_exception();
+        for (auto& req : batch) this->fail(req, err);
+        batch.clear();
+        queries.clear();
+        continue;
+      }
+
+      for (ui32 i = 0; i < batch.size(); ++i) {
+        try {
+          if (batch[i].callback) batch[i].callback(std::move(results[i]));
+          else                   batch[i].promise.set_value(std::move(results[i]));
+        } catch (...) {
+          this->fail(batch[i], std::current_exception());
+        }
+      }
+
+      batch.clear();
+      queries.clear();
+    }
+  }
+
+public:
+  AsyncQueryEngine(LSHForest<D>& index, AsyncQueryConfig config = AsyncQueryConfig())
+    : index(index), config(config)
+  {
+    assert(config.queue_capacity > 0 && config.max_batch > 0);
+    dispatcher = std::thread(&AsyncQueryEngine<D>::dispatch, this);
+  }
+
+  /**
+   * @brief Answers all pending queries and stops the dispatcher
+   */
+  ~AsyncQueryEngine() {
+    {
+      std::unique_lock<std::mutex> lock(mtx);
+      stopping = true;
+    }
+    not_empty.notify_all();
+    not_full.notify_all();
+    dispatcher.join();
+  }
+
+  /**
+   * @brief Submits a query, blocking while the queue of pending queries is full
+   * @returns A future holding the indices of the k nearest neighbours in ascending order by distance
+   */
+  std::future<std::vector<ui32>> submit(const Point<D>& query) {
+    Request req{ query, {}, {}, {} };
+    auto ret = req.promise.get_future();
+    [[maybe_unused]] const bool enqueued = enqueue(std::move(req), true);
+    assert(enqueued);
+    return ret;
+  }
+
+  /**
+   * @brief Submits a query, blocking while the queue of pending queries is full
+   * @param callback Called on the dispatcher thread with the result of the query
+   */
+  void submit(const Point<D>& query, Callback callback) {
+    [[maybe_unused]] const bool enqueued = enqueue(Request{ query, {}, std::move(callback), {} }, true);
+    assert(enqueued);
+  }
+
+  /**
+   * @brief Submits a query unless the queue of pending queries is full
+   * @param callback Called on the dispatcher thread with the result of the query
+   * @returns False if the query was rejected
+   */
+  bool try_submit(const Point<D>& query, Callback callback) {
+    return enqueue(Request{ query, {}, std::move(callback), {} }, false);
+  }
+
+  /**
+   * @returns Number of queries waiting to be dispatched
+   */
+  ui32 pending() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return requests.size();
+  }
+
+  /**
+   * @brief Returns and clears the first error of a callback query since the last call, 
+   *        thrown either while answering its batch or by its callback
+   * @returns nullptr if no callback query failed
+   */
+  std::exception_ptr take_error() {
+    std::unique_lock<std::mutex> lock(mtx);
+    return std::exchange(callback_error, nullptr);
+  }
+
+  /**
+   * @returns The batch size the dispatcher currently waits for
+   */
+  ui32 batch_size() const {
+    std::unique_lock<std::mutex> lock(mtx);
+    return target_batch;
+  }
+};
@@ -7,14 +7,14 @@
 #include "../global.hpp"
 
 /** Mask of next buckets */
-class BucketMask : public std::vector<std::vector<ui32>> {
+class BucketMask : public std::vector<std::vector<ui64>> {
 public:
-  BucketMask(ui32 depth = 32U, ui32 max_hdist = 4U) : std::vector<std::vector<ui32>>() {
+  BucketMask(ui32 depth = 32U, ui32 max_hdist = 4U) : std::vector<std::vector<ui64>>() {
     ui32 constructed_masks = 0;
     if (max_hdist > depth) max_hdist = depth;
     for (ui32 hdist = 0; hdist <= max_hdist; ++hdist) {
       
-      this->emplace_back(std::vector<ui32>());
+      this->emplace_back(std::vector<ui64>());
       // Initalize a bitset of size D with hdist bits set
       std::vector<bool> vmask(depth, false);
       
@@ -22,10 +22,10 @@ public:
       std::fill(vmask.begin(), vmask.begin() + hdist, true);
       std::sort(ALL(vmask));
       
-      // create ui32 masks
+      // create ui64 masks
       do {
-        // Transform vmask to ui32
-        ui32 m = std::accumulate(vmask.rbegin(), vmask.rend(), 0, [](ui32 x, ui32 y) { return (x << 1UL) + y; });
+        // Transform vmask to ui64
+        ui64 m = std::accumulate(vmask.rbegin(), vmask.rend(), 0ULL, [](ui64 x, bool y) { return (x << 1ULL) + y; });
         this->at(hdist).emplace_back(m);
 
         // Ensure we don't go out of bound
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <chrono>
+#include <span>
+
 #include "../global.hpp"
 #include "point.hpp"
 
@@ -12,17 +15,34 @@ struct QueryLog {
        hdist = 0,      // The hamming distance of the mask we stopped at
        found = 0,      // The total number of points found
        visited = 0;    // The number of buckets visited
+  bool exhausted = false; // True if the query stopped because its budget ran out
   
   friend std::ostream& operator<<(std::ostream& os, const QueryLog& log) {
     os << "QueryLog: " << std::endl
        << "\tStopped at mask_index: " << log.mask_index << std::endl
        << "\tStopped at hdist: " << log.hdist << std::endl
        << "\tTotal points found: " << log.found << std::endl
-       << "\tBuckets visited: " << log.visited << std::endl;
+       << "\tBuckets visited: " << log.visited << std::endl
+       << "\tBudget exhausted: " << log.exhausted << std::endl;
     return os;
   }
 };
 
+/**
+ * @brief Limits on the work done by a single query. Once a limit is reached the query
+ *        stops and returns the k nearest points found so far.
+ */
+struct QueryBudget {
+  std::chrono::nanoseconds time = std::chrono::nanoseconds::max(); // Maximum duration of the query
+  ui32 candidates = UINT32_MAX; // Maximum number of candidate points to compute distances to
+
+  /**
+   * @brief Optional progressive mode. If set, it is called with the current k nearest points
+   *        in ascending order by distance whenever they grow in number or their kth distance improves while probing.
+   */
+  std::function<void(const std::vector<ui32>&)> on_progress;
+};
+
 template<ui32 D>
 class Index {
   public:
@@ -50,6 +70,48 @@ class Index {
      */
     virtual std::vector<ui32> query(const Point<D>& point, int k, float recall, QueryLog* log = nullptr) = 0;
 
+    /**
+     * @brief Answers a batch of queries. Indexes that can share work between queries 
+     *        should override this, by default each query is answered on its own.
+     * @param queries Points to query for
+     * @param k number of nearest neighbors to return for each query
+     * @param recall The precision of the queries
+     * @return A vector for which the i'th element contains the result of the query for @queries[i]
+     */
+    virtual std::vector<std::vector<ui32>> batch_query(const std::vector<Point<D>>& queries, int k, float recall) {
+      std::vector<std::vector<ui32>> results(queries.size());
+      for (ui32 q = 0; q < queries.size(); ++q) {
+        results[q] = this->query(queries[q], k, recall);
+      }
+      return results;
+    }
+
+    /**
+     * @brief Answers a batch of queries into flat row-major buffers of size @queries.size() * @k,
+     *        such that results can be written without nested allocations, e.g. directly into HDF5 datasets.
+     *        Rows of queries with less than @k results are padded with UINT32_MAX.
+     * @param queries Points to query for
+     * @param k number of nearest neighbors to return for each query
+     * @param recall The precision of the queries
+     * @param ids ids[q*k + i] : index of the i'th nearest neighbour of @queries[q]
+     * @param dists dists[q*k + i] : hamming distance of ids[q*k + i] to @queries[q], may be empty if not needed
+     */
+    virtual void query_into(const std::vector<Point<D>>& queries, ui32 k, float recall, 
+                            std::span<ui32> ids, std::span<ui32> dists = {}) {
+      const ui64 total = (ui64) queries.size() * k;
+      assert(ids.size() >= total && (dists.empty() || dists.size() >= total));
+      for (ui32 q = 0; q < queries.size(); ++q) {
+        const auto result = this->query(queries[q], k, recall);
+        const ui64 row = (ui64) q * k;
+        for (ui32 i = 0; i < k; ++i) {
+          ids[row + i] = i < result.size() ? result[i] : UINT32_MAX;
+          if (!dists.empty()) {
+            dists[row + i] = i < result.size() ? queries[q].distance((*this)[result[i]]) : UINT32_MAX;
+          }
+        }
+      }
+    }
+
     /**
      * @param i index of the point to return
      */
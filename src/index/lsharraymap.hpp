@@ -5,7 +5,7 @@
 template <ui32 D>
 class LSHArrayMap : public LSHMap<D> {
   // all possible masks by hamming distance 
-  static inline std::vector<std::vector<ui32>> masks = std::vector<std::vector<ui32>>();
+  static inline std::vector<std::vector<hash_idx>> masks = std::vector<std::vector<hash_idx>>();
   
   void initMasks() {
     for (ui32 hdist = 0; hdist <= this->depth(); ++hdist) {
@@ -13,9 +13,9 @@ class LSHArrayMap : public LSHMap<D> {
       // so we recompute since each time the depth increases new options emerge.
       if (LSHArrayMap<D>::masks.size() > hdist) 
       {
-        LSHArrayMap<D>::masks[hdist] = std::vector<ui32>(); 
+        LSHArrayMap<D>::masks[hdist] = std::vector<hash_idx>(); 
       } else {
-        LSHArrayMap<D>::masks.emplace_back(std::vector<ui32>());
+        LSHArrayMap<D>::masks.emplace_back(std::vector<hash_idx>());
       } 
 
       // Initalize a bitset of size depth with hdist bits set
@@ -25,10 +25,10 @@ class LSHArrayMap : public LSHMap<D> {
       std::fill(vmask.begin(), vmask.begin() + hdist, true);
       std::sort(ALL(vmask));
       
-      // create ui32 masks
+      // create masks
       do {
-        // Transform vmask to ui32
-        ui32 m = accumulate(vmask.rbegin(), vmask.rend(), 0, [](ui32 x, ui32 y) { return (x << 1UL) + y; });
+        // Transform vmask to hash_idx
+        hash_idx m = std::accumulate(vmask.rbegin(), vmask.rend(), (hash_idx) 0, [](hash_idx x, bool y) { return (x << 1ULL) + y; });
         LSHArrayMap<D>::masks[hdist].emplace_back(m);
         // Ensure we don't go out of bound
       } while (std::next_permutation(ALL(vmask)));
@@ -61,6 +61,7 @@ public:
   void build(HashFamily<D>& hf) {
     this->hashes = hf;
     buckets.clear();
+    this->invalidate_buckets();
     buckets.resize((1ULL << hf.size()), bucket());
     count = 0;
     if (masks.size() < this->depth() + 1)
@@ -82,20 +83,21 @@ public:
   /**
    * @returns Number of buckets in the map
    */
-  ui32 bucketCount() const { return this->buckets.size(); };
+  ui64 bucketCount() const { return this->buckets.size(); };
 
   /**
    * @brief Inserts a point into the map
    */
   void add(const Point<D> &point) {
     const hash_idx index = this->hash(point);
+    this->invalidate_buckets();
     buckets[index].emplace_back(count++);
   };
 
   /**
-   * @brief Inserts a vector of points into the map
+   * @brief Inserts a range of points into the map
    */
-  void add(std::vector<Point<D>> &points) {
+  void add(std::span<const Point<D>> points) {
     for (const auto& p : points) {
       this->add(p);
     }
@@ -166,13 +168,22 @@ public:
   };
 
   /**
-   * @brief Retrieve the bucket at the specified bucket-index
+   * @brief Retrieve a view of the bucket at the specified bucket-index
    */
-  bucket& operator[](hash_idx bidx) {
-    
+  bucket_view operator[](hash_idx bidx) const {
+
     assert(bidx < this->buckets.size());
     return this->buckets[bidx];
   }
+
+  /**
+   * @brief Calls @fn with the index and a view of every non-empty bucket
+   */
+  void for_each_bucket(const std::function<void(hash_idx, bucket_view)>& fn) const {
+    for (hash_idx bidx = 0; bidx < this->buckets.size(); ++bidx) {
+      if (!this->buckets[bidx].empty()) fn(bidx, this->buckets[bidx]);
+    }
+  }
   
 private:
   std::vector<bucket> buckets;
@@ -1,15 +1,36 @@
 #pragma once
 
+#include <bit>
+#include <memory>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "./query/pointmap.hpp"
+#include "pointstore.hpp"
+#include "pivottable.hpp"
+#include "shortsketches.hpp"
 #include "index.hpp"
 #include "lshmap.hpp"
 #include "lshmapfactory.hpp"
 #include "./query/failureprob.hpp"
+#include "./query/recallcalibration.hpp"
+#include "./query/querycache.hpp"
+#include "./query/queryorder.hpp"
+#include "./query/querycontext.hpp"
+#include "../hash/flipmodel.hpp"
+#include "../util/threadpool.hpp"
 
 const QueryFailureProbability DEFAULT_FAILURE = TestSizeFailure;
 
+/**
+ * @brief The order in which a query probes the buckets of the maps in a forest
+ */
+enum class ProbeSchedule {
+  Lockstep, // All maps probe the bucket at the same (hdist, mask_index) before any map moves on
+  Yield,    // Slices of all maps are scanned in descending order by their estimated yield of new near neighbours.
+            // Maps whose hashes have margins are probed in query-directed order, see ProbeCursor
+};
+
 template<ui32 D>
 class LSHForest : public Index<D> {
    // A function that calculates the failure-probability of an ongoing query
@@ -19,24 +40,67 @@ class LSHForest : public Index<D> {
   const ui32 depth;
   
   // The points in the forest
-  std::vector<Point<D>>& points;
+  PointStore<D> points;
+
+  // ids[offsets[i]..offsets[i+1]) : external ids of the point stored at index i, which has several if it was 
+  // deduplicated, and positions[e] : index of the point with external id e. 
+  // All are empty until the points are reordered or deduplicated, until then external ids equal indices.
+  std::vector<ui32> ids, offsets, positions;
 
   // The trees (LSHMaps) in the forest
   std::vector<LSHMap<D>*>& maps;
 
+  // Candidate budgets by recall, replace the failure-probability stop rule when not empty. Single queries and
+  // batch queries reach candidates in different orders, so each is calibrated under its own schedule.
+  RecallCalibration calibration,       // budgets of single queries under schedule
+                    batch_calibration; // budgets of the lockstep blocks of batch_query
+
+  // Optional cache of query results, consulted by query and batch_query
+  std::unique_ptr<QueryCache<D>> cache;
+
+  // The probe schedule of single queries, batch queries always probe in lockstep to share bucket scans.
+  // Yield is opt-in through set_probe_schedule, since it changes the candidates and results of single queries.
+  ProbeSchedule schedule = ProbeSchedule::Lockstep;
+
+  // Buckets of at least inline_min_size points in the first inline_maps maps store copies of their points
+  ui32 inline_min_size = UINT32_MAX,
+       inline_maps = 0;
+
+  // Buckets of [summary_min_size, summary_max_size] points store the AND and OR of their points, none if min > max
+  ui32 summary_min_size = UINT32_MAX,
+       summary_max_size = 0;
+
+  // Short sketches of the points, indexed like points, that pre-filter the candidates of queries if not empty
+  ShortSketches<D> shorts;
+  float short_slack = INFINITY;
+
+  // Distances of the points to a few pivots, indexed like points, that filter the candidates of queries if not empty
+  PivotTable<D> pivots;
+
 public:
+  /**
+   * @brief Constructs a forest over a copy of @input in a PointStore configured by @config
+   */
   LSHForest(std::vector<LSHMap<D>*> &maps, 
-            std::vector<Point<D>> &input, 
+            const std::vector<Point<D>> &input, 
+            QueryFailureProbability failure_strategy = DEFAULT_FAILURE,
+            PointStoreConfig config = PointStoreConfig()) 
+    : LSHForest(maps, PointStore<D>(input, config), failure_strategy)
+  {};
+
+  /**
+   * @brief Constructs a forest over the points of @store, which may borrow external memory
+   */
+  LSHForest(std::vector<LSHMap<D>*> &maps, 
+            PointStore<D> store, 
             QueryFailureProbability failure_strategy = DEFAULT_FAILURE) 
     : is_exit(failure_strategy), 
       depth(maps.empty() ? 0 : maps.front()->depth()), 
-      points(input), 
+      points(std::move(store)), 
       maps(maps)
   {};
 
   ~LSHForest() {
-    this->points.clear();
-    
     while(!this->maps.empty())
     {
       LSHMap<D>* m = this->maps.back();
@@ -47,19 +111,299 @@ public:
   
   const std::vector<LSHMap<D>*>& getMaps() { return maps; }
 
-  ui32 size() const noexcept { return points.size(); };
+  /**
+   * @returns Number of points inserted into the forest, including duplicates collapsed by deduplicate
+   */
+  ui32 size() const noexcept { return positions.empty() ? points.size() : positions.size(); };
+
+  const PointStore<D>& get_points() const noexcept { return points; }
   
   // If we care about build performance, this needs to be emplace_back, and then we should implement a copy constructor for points
-  void insert(Point<D>& point) { points.push_back(point); }; 
+  void insert(Point<D>& point) { 
+    if (!ids.empty()) {
+      ids.push_back(positions.size());
+      offsets.push_back(ids.size());
+      positions.push_back(points.size());
+    }
+    if (shorts.bits()) shorts.push_back(point);
+    if (pivots.count()) pivots.push_back(point);
+    points.push_back(point); 
+    if (cache) cache->invalidate();
+  }; 
   
   void build() {
-    for (auto &map : this->maps) {
-      if (map->size() < this->size()) {
-        map->add(this->points);
+    if (cache) cache->invalidate();
+    ThreadPool::instance().parallel_for(0, this->maps.size(), 1, [this](ui32 m) {
+      // Only the points inserted since the map was last built are added, such that indices stay aligned
+      if (this->maps[m]->size() < this->points.size()) {
+        this->maps[m]->add(std::span<const Point<D>>(this->points).subspan(this->maps[m]->size()));
       }
-    }
+    });
+    this->refresh_buckets();
   };
+
+  /**
+   * @brief Renumbers the points in @order of their keys in the first maps, such that points sharing buckets 
+   *        are stored next to each other, and candidates of a bucket share cache lines and pages. 
+   *        The maps are rebuilt on the renumbered points, while queries keep returning the ids of the points 
+   *        in insertion order.
+   * @param order The order of the points, see QueryOrder
+   */
+  void reorder(QueryOrder order = QueryOrder::MapKey) {
+    const std::vector<ui32> perm = QueryOrdering::permutation(this->points, this->maps, order);
+    this->renumber(perm, [&perm](ui32 j) { return std::span<const ui32>(&perm[j], 1); });
+  }
+
+  /**
+   * @brief Stores every distinct point once, such that exact duplicates are inserted into the maps and 
+   *        distance-checked by queries only once. The ids of the duplicates of a point are kept in a 
+   *        compact alias table, and are expanded when a query produces its k results.
+   *        Points inserted afterwards are not checked for duplicates until the next call.
+   * @returns The number of collapsed duplicates
+   */
+  ui32 deduplicate() {
+    const ui32 N = this->points.size();
+    std::vector<ui32> group(N); // group[i] : index of the first copy of points[i], later the index of its distinct point
+    std::vector<ui32> unique;   // indices of the first copies in input order
+    {
+      // Open addressing table of point indices, hashed and compared through the points themselves
+      const ui64 mask = std::bit_ceil(2 * (ui64) std::max(N, 1U)) - 1;
+      std::vector<ui32> table(mask + 1, UINT32_MAX);
+      const std::hash<std::bitset<D>> hasher;
+      for (ui32 i = 0; i < N; ++i) {
+        ui64 h = hasher(this->points[i]) & mask;
+        while (table[h] != UINT32_MAX && this->points[table[h]] != this->points[i]) h = (h + 1) & mask;
+        if (table[h] == UINT32_MAX) {
+          table[h] = i;
+          unique.push_back(i);
+        }
+        group[i] = table[h];
+      }
+    }
+    const ui32 U = unique.size();
+    if (U == N) return 0;
+
+    // First copies precede their duplicates, so they are numbered before they are looked up
+    for (ui32 i = 0, j = 0; i < N; ++i) group[i] = group[i] == i ? j++ : group[group[i]];
+
+    // members[starts[j]..starts[j+1]) : indices of the copies of points[unique[j]], counted and placed in two passes
+    std::vector<ui32> starts(U + 1, 0), members(N);
+    for (ui32 i = 0; i < N; ++i) ++starts[group[i] + 1];
+    std::partial_sum(ALL(starts), starts.begin());
+    {
+      std::vector<ui32> next(starts.begin(), starts.end() - 1);
+      for (ui32 i = 0; i < N; ++i) members[next[group[i]]++] = i;
+    }
+
+    this->renumber(unique, [&starts, &members](ui32 j) { 
+      return std::span<const ui32>(&members[starts[j]], starts[j + 1] - starts[j]); 
+    });
+    return N - U;
+  }
+
+  /**
+   * @returns The first external id of the point stored at index @i
+   */
+  inline ui32 external_id(ui32 i) const noexcept { return ids.empty() ? i : ids[offsets[i]]; }
   
+  /**
+   * @brief Fits the stop rule of the forest to @queries with known ground truth. Each query is run with 
+   *        a growing candidate budget, and the smallest budget for which the sample reliably 
+   *        reaches each of the @recalls is stored in the calibration table used by subsequent queries.
+   *        Single queries are calibrated under the current probe schedule, and batch queries through 
+   *        the lockstep blocks of batch_query, since the two reach candidates in different orders.
+   *        The budgets only apply to queries for @k nearest neighbours, other queries keep the failure-probability
+   *        stop rule. A calibrated query never stops before it holds k points.
+   * @param queries A sample of query points
+   * @param answers answers[q] : the hamming distances of the true nearest neighbours of queries[q] 
+   *                in ascending order, as stored in the answers of the benchmark datasets
+   * @param k Number of nearest neighbors to calibrate for
+   * @param recalls The recalls to calibrate
+   * @return The fitted calibration table of single queries
+   */
+  const RecallCalibration& calibrate(const std::vector<Point<D>>& queries,
+                                     const std::vector<std::vector<ui32>>& answers,
+                                     ui32 k,
+                                     const std::vector<float>& recalls = { 0.8f, 0.85f, 0.9f, 0.95f, 0.99f })
+  {
+    assert(queries.size() == answers.size() && !recalls.empty());
+    const ui32 Q = queries.size();
+
+    // Returns the fraction of the k results of queries[q] within its true kth distance
+    auto recall_of = [&](ui32 q, const std::vector<ui32>& result) {
+      assert(answers[q].size() >= k);
+      return std::count_if(ALL(result), [&](ui32 pidx) { 
+        return queries[q].distance((*this)[pidx]) <= answers[q][k-1]; 
+      }) / (float) k;
+    };
+
+    this->set_calibration(this->fit_calibration(Q, k, recalls, [&](ui32 c, std::vector<float>& achieved) {
+      ThreadPool::instance().parallel_for(0, Q, 1, [&, c](ui32 q) {
+        achieved[q] = recall_of(q, this->query_local(queries[q], k, 1.0, nullptr, nullptr, c));
+      });
+    }));
+    this->set_batch_calibration(this->fit_calibration(Q, k, recalls, [&](ui32 c, std::vector<float>& achieved) {
+      auto results = this->batch_query_blocks(queries, k, 1.0, c);
+      for (ui32 q = 0; q < Q; ++q) achieved[q] = recall_of(q, results[q]);
+    }));
+    return this->calibration;
+  }
+
+  const RecallCalibration& get_calibration() const noexcept { return calibration; }
+
+  const RecallCalibration& get_batch_calibration() const noexcept { return batch_calibration; }
+
+  /**
+   * @brief Sets the candidate budgets of single queries, which are only valid for the current probe schedule
+   */
+  void set_calibration(RecallCalibration c) { 
+    this->calibration = std::move(c); 
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @brief Sets the candidate budgets of batch queries
+   */
+  void set_batch_calibration(RecallCalibration c) { 
+    this->batch_calibration = std::move(c); 
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @brief Estimates the flip rates of the sketch dimensions from @queries with known ground truth, 
+   *        and orders the probe sequences of the maps by them, see set_flip_model
+   * @param answers answers[q] : the hamming distances of the true nearest neighbours of queries[q] 
+   *                in ascending order, as stored in the answers of the benchmark datasets
+   * @param k Number of nearest neighbours to train on
+   * @return The fitted flip model
+   */
+  FlipModel<D> train_flip_model(const std::vector<Point<D>>& queries,
+                                const std::vector<std::vector<ui32>>& answers,
+                                ui32 k)
+  {
+    FlipModel<D> model = FlipModel<D>::fit(this->points, queries, answers, k);
+    this->set_flip_model(model);
+    return model;
+  }
+
+  /**
+   * @brief Replaces the margins of the single-bit hashes in every map by the flip scores of @model, 
+   *        such that query-directed probing visits the buckets most likely to hold near neighbours first.
+   */
+  void set_flip_model(const FlipModel<D>& model) {
+    for (auto map : this->maps) model.apply(map->hashes);
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @brief Stores copies of the points of every bucket of at least @min_bucket_size points in the first @n_maps maps 
+   *        next to the ids of the bucket, such that scanning the bucket reads its points sequentially instead of 
+   *        fetching each from the point store at random. Trades memory, see inlined_bytes, for fewer cache misses. 
+   *        The copies are refreshed by build and reorder.
+   * @param min_bucket_size The minimum size of an inlined bucket, 1 inlines every bucket
+   * @param n_maps Number of maps to inline buckets of, 0 disables inlining
+   */
+  void set_inline_points(ui32 min_bucket_size, ui32 n_maps = UINT32_MAX) {
+    this->inline_min_size = std::max(min_bucket_size, 1U);
+    this->inline_maps = n_maps;
+    this->refresh_buckets();
+  }
+
+  /**
+   * @returns Number of bytes used by the inlined copies of the points in all maps
+   */
+  ui64 inlined_bytes() const {
+    ui64 bytes = 0;
+    for (auto map : this->maps) bytes += map->inlined_bytes();
+    return bytes;
+  }
+
+  /**
+   * @brief Summarizes every bucket of [@min_bucket_size, @max_bucket_size] points by the AND and OR of its points, 
+   *        from which queries bound the distance to all points of the bucket, and skip the bucket without reading 
+   *        its ids or points once the bound reaches their kth distance. Bounds are tight for small buckets and 
+   *        for buckets of near-duplicates, which are most of the buckets probed late at hamming distances 2-4. 
+   *        The summaries are refreshed by build and reorder.
+   * @param min_bucket_size The minimum size of a summarized bucket, 1 summarizes every bucket up to @max_bucket_size
+   * @param max_bucket_size The maximum size of a summarized bucket, 0 disables the summaries
+   */
+  void set_bucket_summaries(ui32 min_bucket_size, ui32 max_bucket_size = UINT32_MAX) {
+    this->summary_min_size = std::max(min_bucket_size, 1U);
+    this->summary_max_size = max_bucket_size;
+    this->refresh_buckets();
+  }
+
+  /**
+   * @returns Number of bytes used by the bucket summaries of all maps
+   */
+  ui64 summary_bytes() const {
+    ui64 bytes = 0;
+    for (auto map : this->maps) bytes += map->summary_bytes();
+    return bytes;
+  }
+
+  /**
+   * @brief Keeps a short sketch of @bits high-variance dimensions of every point, with which queries reject 
+   *        candidates before computing their full distance, see PointMap::set_prefilter
+   * @param bits Number of dimensions of a short sketch, at most ShortSketches<D>::MAX_BITS, 0 disables the filter
+   * @param slack INFINITY only rejects candidates whose short distance bounds them out of the result, 
+   *              a finite slack also rejects candidates estimated to be far, at the cost of recall
+   */
+  void set_short_sketches(ui32 bits, float slack = INFINITY) {
+    this->shorts = bits ? ShortSketches<D>(ShortSketches<D>::select_dims(this->points, bits)) : ShortSketches<D>();
+    this->shorts.assign(this->points);
+    this->short_slack = slack;
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @returns Number of bytes used by the short sketches of the points
+   */
+  ui64 short_sketch_bytes() const noexcept { return shorts.bytes(); }
+
+  /**
+   * @brief Selects @count pivots among the points and stores the distance of every point to them, with which 
+   *        queries reject far candidates by the triangle inequality without reading them, see PointMap::set_pivots
+   * @param count Number of pivots, at most PivotTable<D>::MAX_PIVOTS, 0 disables the filter
+   */
+  void set_pivots(ui32 count = PivotTable<D>::DEFAULT_PIVOTS) {
+    this->pivots = count ? PivotTable<D>(PivotTable<D>::select_pivots(this->points, count)) : PivotTable<D>();
+    this->pivots.assign(this->points);
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @returns Number of bytes used by the pivot distances of the points
+   */
+  ui64 pivot_bytes() const noexcept { return pivots.bytes(); }
+
+  ProbeSchedule get_probe_schedule() const noexcept { return schedule; }
+
+  /**
+   * @brief Sets the probe schedule of single queries. Their calibration was fitted under the previous schedule 
+   *        and is dropped when the schedule changes.
+   */
+  void set_probe_schedule(ProbeSchedule s) { 
+    if (s != this->schedule) this->calibration = RecallCalibration();
+    this->schedule = s; 
+    if (cache) cache->invalidate();
+  }
+
+  /**
+   * @brief Places a QueryCache in front of the forest, replacing the current cache if any.
+   *        Cached results are invalidated whenever points are inserted or the forest is rebuilt.
+   */
+  void enable_cache(QueryCacheConfig config = QueryCacheConfig()) { 
+    this->cache = std::make_unique<QueryCache<D>>(config); 
+  }
+
+  void disable_cache() { this->cache.reset(); }
+
+  /**
+   * @returns The cache of the forest, or nullptr if caching is disabled
+   */
+  QueryCache<D>* get_cache() const noexcept { return cache.get(); }
+
   inline float get_bucket_factor(const float recall) const noexcept {
     const float recall_factor = (1.0 - recall) / 0.05;
     const float bucket_frac = ((1000.0 + std::log2(this->maps.front()->bucketCount())) * this->maps.size());
@@ -70,43 +414,33 @@ public:
   /**
    * @brief Returns the indices of the @k nearest neighbors to for a list of points, where
    *        atleast a @recall fraction of the points are among the true kNN on avg. 
-   *        The queries are handled by @thread_cnt threads.
+   *        The queries are handed to the shared ThreadPool in small chunks of consecutive queries in @order, 
+   *        such that idle workers steal the remaining queries of a worker stuck on slow queries.
+   *        Ordering the queries by their keys makes queries probing the same buckets run back-to-back 
+   *        on the same thread, which reuses the buckets and points already in its caches.
    * @param queries Points to query for
    * @param k Number of nearest neighbors to find for each point
    * @param recall The precision of the query
-   * @param thread_cnt The number of threads to use, defaults to std::thread::hardware_concurrency().
+   * @param thread_cnt The largest number of threads of the shared ThreadPool answering the queries at the same time,
+   *                   defaults to all of them
+   * @param order The order in which the queries are answered
    * @return std::vector<std::vector<ui32>> For which the i'th vector contains the indices of the k-nearest-neighbours 
    *         in ascending order by distance for @queries[i]. 
    */
-  std::vector<std::vector<ui32>> mthread_queries(std::vector<Point<D>>& queries, int k, float recall = 0.9, ui32 thread_cnt = 0) {
+  std::vector<std::vector<ui32>> mthread_queries(std::vector<Point<D>>& queries, int k, float recall = 0.9, ui32 thread_cnt = 0,
+                                                 QueryOrder order = QueryOrder::Input) {
     assert(thread_cnt <= std::thread::hardware_concurrency());
-    if (!thread_cnt) thread_cnt = std::thread::hardware_concurrency();
 
-    std::vector<std::vector<ui32>> results(queries.size(), std::vector<ui32>()),
-                                   batches(thread_cnt, std::vector<ui32>()); // indices of points in queries
-    
-    // Split the queries into thread_cnt batches
-    for (ui32 i = 0; i < queries.size(); ++i) {
-      batches[i % thread_cnt].emplace_back(i);
-    }
+    std::vector<std::vector<ui32>> results(queries.size(), std::vector<ui32>());
+    const std::vector<ui32> perm = QueryOrdering::permutation(queries, this->maps, order);
 
-    auto answer_batch = [this, k, recall, &queries, &results, &batches](ui32 bidx) {
-      for (auto& pidx : batches[bidx]) {
-        results[pidx] = this->query(queries[pidx], k, recall);
-      }
+    auto answer_query = [this, k, recall, &queries, &results, &perm](ui32 i) {
+      const ui32 pidx = perm[i];
+      results[pidx] = this->query(queries[pidx], k, recall);
     };
-    
-    // Spawn threads that answer queries
-    std::vector<std::thread> pool(thread_cnt);
-    for (ui32 i=0; i < thread_cnt; ++i) {
-      pool[i] = std::thread(answer_batch, i);
-    }
-      
-    // wait for threads to finish
-    for (auto& th : pool) {
-      th.join();
-    }
-  
+
+    ThreadPool::instance().parallel_for(0, queries.size(), QUERY_CHUNK_SIZE, answer_query, thread_cnt);
+
     return results;
   }
 
@@ -117,32 +451,288 @@ public:
    * @param k Number of nearest neighbors to find
    * @param recall The precision of the query
    * @param log A ptr to a query log to use for storing additional query information.
+   *            Logged queries bypass the cache, such that the log always describes a full query.
    * @return std::vector<ui32> A vector of size @k containing the indices of the k-nearest-neighbours 
    *         in ascending order by distance. 
    */
   std::vector<ui32> query(const Point<D>& point, int k, float recall = 0.9, QueryLog *log = nullptr)
   {
-    PointMap<D> found(this->points, point, k);  // found : contains the k nearest points found so far and look up of seen points
+    if (log) return this->query_local(point, k, recall, nullptr, log, this->calibration.budget(recall, k));
 
-    const ui32 M = this->maps.size(), 
-               BATCH_SIZE = k * this->get_bucket_factor(recall);
+    return QueryContext<D>::with_local([&](QueryContext<D>& ctx) {
+      auto result = this->query(point, k, recall, ctx);
+      return std::vector<ui32>(ALL(result));
+    });
+  }
+
+  /**
+   * @brief Returns the indices of the @k nearest neighbors to @point where atleast a @recall fraction 
+   *        of the points are among the true kNN, using the scratch memory of @ctx. 
+   *        Once @ctx is warmed up, a query that is not answered by the cache does not allocate.
+   * @param point Point to query for
+   * @param k Number of nearest neighbors to find
+   * @param recall The precision of the query
+   * @param ctx The context of the query, it must not be used by another query at the same time.
+   *            The hamming distances of the result to @point are stored in ctx.dists.
+   * @return std::span<const ui32> A view of the indices of the k-nearest-neighbours in ascending order by distance, 
+   *         valid until the next query with @ctx.
+   */
+  std::span<const ui32> query(const Point<D>& point, int k, float recall, QueryContext<D>& ctx)
+  {
+    const ui32 target = this->calibration.budget(recall, k);
+    if (!cache) return this->query_impl(ctx, point, k, recall, nullptr, nullptr, target);
+
+    const hash_idx key = this->maps.front()->hash(point);
+    if (auto hit = cache->lookup(point, key, k, recall, SINGLE_QUERY_PATH)) {
+      ctx.result.assign(ALL(*hit));
+      ctx.dists.resize(ctx.result.size());
+      std::transform(ALL(ctx.result), ctx.dists.begin(), [&](ui32 pidx) { return point.distance((*this)[pidx]); });
+      return ctx.result;
+    }
+
+    this->query_impl(ctx, point, k, recall, nullptr, nullptr, target);
+    cache->insert(point, key, k, recall, ctx.result, SINGLE_QUERY_PATH);
+    return ctx.result;
+  }
+
+  /**
+   * @brief Answers a batch of queries on the shared ThreadPool into flat row-major buffers of size @queries.size() * @k.
+   *        Every query is answered with the context of its thread, and its ids and hamming distances are copied 
+   *        straight from the context into the buffers, such that no per-query results are allocated 
+   *        and no distances are recomputed. Rows of queries with less than @k results are padded with UINT32_MAX.
+   * @param queries Points to query for
+   * @param k Number of nearest neighbors to find for each point
+   * @param recall The precision of the queries
+   * @param ids ids[q*k + i] : index of the i'th nearest neighbour of @queries[q]
+   * @param dists dists[q*k + i] : hamming distance of ids[q*k + i] to @queries[q], may be empty if not needed
+   * @param order The order in which the queries are answered
+   */
+  void query_into(const std::vector<Point<D>>& queries, ui32 k, float recall, 
+                  std::span<ui32> ids, std::span<ui32> dists, QueryOrder order) 
+  {
+    const ui64 total = (ui64) queries.size() * k;
+    assert(ids.size() >= total && (dists.empty() || dists.size() >= total));
+    const std::vector<ui32> perm = QueryOrdering::permutation(queries, this->maps, order);
+
+    ThreadPool::instance().parallel_for(0, queries.size(), QUERY_CHUNK_SIZE, [&](ui32 i) {
+      const ui32 q = perm[i];
+      const ui64 beg = (ui64) q * k, end = beg + k; // offsets of the row of queries[q]
+      QueryContext<D>::with_local([&](QueryContext<D>& ctx) {
+        const auto result = this->query(queries[q], k, recall, ctx);
+        std::fill(std::copy(ALL(result), ids.begin() + beg), ids.begin() + end, UINT32_MAX);
+        if (!dists.empty()) {
+          std::fill(std::copy(ALL(ctx.dists), dists.begin() + beg), dists.begin() + end, UINT32_MAX);
+        }
+      });
+    });
+  }
+
+  void query_into(const std::vector<Point<D>>& queries, ui32 k, float recall, 
+                  std::span<ui32> ids, std::span<ui32> dists = {}) override
+  {
+    this->query_into(queries, k, recall, ids, dists, QueryOrder::Input);
+  }
+
+  /**
+   * @brief Returns the indices of the @k nearest neighbors to @point where atleast a @recall fraction 
+   *        of the points are among the true kNN, unless the @budget runs out first. In that case 
+   *        the k nearest points found so far are returned and log->exhausted is set.
+   * @param point Point to query for
+   * @param k Number of nearest neighbors to find
+   * @param recall The precision of the query
+   * @param budget Time and candidate limits of the query, and an optional progress callback
+   * @param log A ptr to a query log to use for storing additional query information.
+   * @return std::vector<ui32> A vector of up to @k indices of the nearest neighbours 
+   *         in ascending order by distance. 
+   */
+  std::vector<ui32> query(const Point<D>& point, int k, float recall, const QueryBudget& budget, QueryLog *log = nullptr)
+  {
+    return this->query_local(point, k, recall, &budget, log, this->calibration.budget(recall, k));
+  }
+
+  /**
+   * @brief Answers a batch of queries by processing blocks of QUERY_BLOCK_SIZE queries together.
+   *        The queries of a block probe the maps in lockstep, and the probes are grouped by (map, bucket)
+   *        such that each bucket is scanned once for all queries in the block that probe it.
+   * @param queries Points to query for
+   * @param k Number of nearest neighbors to find for each point
+   * @param recall The precision of the queries
+   * @return std::vector<std::vector<ui32>> For which the i'th vector contains the indices of the k-nearest-neighbours 
+   *         in ascending order by distance for @queries[i]. 
+   */
+  std::vector<std::vector<ui32>> batch_query(const std::vector<Point<D>>& queries, int k, float recall = 0.9)
+  {
+    const ui32 target = this->batch_calibration.budget(recall, k);
+    if (!cache) return this->batch_query_blocks(queries, k, recall, target);
+
+    // Only the queries missing from the cache are answered by the blocks
+    std::vector<std::vector<ui32>> results(queries.size());
+    std::vector<ui32> missed;
+    std::vector<hash_idx> keys(queries.size());
+    std::vector<Point<D>> missed_queries;
+    for (ui32 q = 0; q < queries.size(); ++q) {
+      keys[q] = this->maps.front()->hash(queries[q]);
+      if (auto hit = cache->lookup(queries[q], keys[q], k, recall, BATCH_QUERY_PATH)) {
+        results[q] = std::move(*hit);
+      } else {
+        missed.push_back(q);
+        missed_queries.push_back(queries[q]);
+      }
+    }
+
+    auto answers = this->batch_query_blocks(missed_queries, k, recall, target);
+    for (ui32 i = 0; i < missed.size(); ++i) {
+      const ui32 q = missed[i];
+      cache->insert(queries[q], keys[q], k, recall, answers[i], BATCH_QUERY_PATH);
+      results[q] = std::move(answers[i]);
+    }
+    return results;
+  }
+
+  /**
+   * @returns The point with external id @i, the ids returned by queries are external
+   */
+  const Point<D> &operator[](ui32 i) const noexcept { return points[positions.empty() ? i : positions[i]]; };
+
+  // Cache tags of the results of single queries and of batch_query, which reach candidates in different orders 
+  // under different calibrations, such that neither answers the other from the cache
+  static constexpr ui32 SINGLE_QUERY_PATH = 0, 
+                        BATCH_QUERY_PATH = 1;
 
-    std::vector<ui32> hash(M); // hash[m] : contains the hash of point in map[m]
+  // Number of queries processed together by batch_query
+  static constexpr ui32 QUERY_BLOCK_SIZE = 64;
+
+  // Number of queries per task submitted to the ThreadPool by mthread_queries
+  static constexpr ui32 QUERY_CHUNK_SIZE = 8;
+
+  // Growth factor of the candidate budgets tried by calibrate
+  static constexpr float CALIBRATION_GROWTH = 1.25f;
+
+  // Relative yield of a bucket one bit further from the bucket of the query, used by ProbeSchedule::Yield
+  static constexpr float YIELD_HDIST_DECAY = 0.5f;
+
+private:
+  /**
+   * @brief Runs @measure(c, achieved) with a growing candidate budget c, where @measure stores the recall of every 
+   *        one of the @Q sample queries stopped at c in achieved, until the sample reliably reaches the 
+   *        largest of the @recalls or c reaches the largest useful budget
+   * @returns The calibration table fitted from the measurements
+   */
+  template<typename Measure>
+  RecallCalibration fit_calibration(ui32 Q, ui32 k, const std::vector<float>& recalls, Measure measure) {
+    const ui32 MAX_CANDIDATES = std::min(2000 * (ui32) this->maps.size(), (ui32) this->points.size());
+    const float target = *std::max_element(ALL(recalls));
+
+    // measurements : pairs of (candidates, recall of every query when stopped at candidates)
+    std::vector<std::pair<ui32, std::vector<float>>> measurements;
+    for (ui32 c = k; ; c = std::min(MAX_CANDIDATES, std::max(c + 1, (ui32) (c * CALIBRATION_GROWTH)))) 
+    {
+      std::vector<float> achieved(Q, 0.0);
+      measure(c, achieved);
+      measurements.emplace_back(c, std::move(achieved));
+
+      if (c >= MAX_CANDIDATES || RecallCalibration::confidence_bound(measurements.back().second) >= target) break;
+    }
+    RecallCalibration ret = RecallCalibration::fit(measurements, recalls);
+    ret.set_k(k);
+    return ret;
+  }
+
+  /**
+   * @brief Implementation of batch_query without the cache
+   * @param target Calibrated number of candidates after which a query stops, 
+   *               or UINT32_MAX to stop by the failure-probability of the query
+   */
+  std::vector<std::vector<ui32>> batch_query_blocks(const std::vector<Point<D>>& queries, int k, float recall, 
+                                                    ui32 target)
+  {
+    std::vector<std::vector<ui32>> results(queries.size());
+    const ui32 blocks = (queries.size() + QUERY_BLOCK_SIZE - 1) / QUERY_BLOCK_SIZE;
+
+    // Blocks are answered in parallel on the shared ThreadPool
+    ThreadPool::instance().parallel_for(0, blocks, 1, [this, k, recall, target, &queries, &results](ui32 b) {
+      const ui32 beg = b * QUERY_BLOCK_SIZE, 
+                 end = std::min(beg + QUERY_BLOCK_SIZE, (ui32) queries.size());
+      this->query_block(queries, beg, end, k, recall, target, results);
+    });
+    return results;
+  }
+
+  /**
+   * @brief Answers the query with the context of the calling thread and returns a copy of the result
+   */
+  std::vector<ui32> query_local(const Point<D>& point, int k, float recall, const QueryBudget* budget, QueryLog *log, 
+                                ui32 target = UINT32_MAX)
+  {
+    return QueryContext<D>::with_local([&](QueryContext<D>& ctx) {
+      return this->query_impl(ctx, point, k, recall, budget, log, target);
+    });
+  }
+
+  /**
+   * @brief Implementation of query, stopping early if the optional @budget runs out
+   * @param ctx The scratch memory of the query, the result is stored in ctx.result
+   * @param target Calibrated number of candidates after which the query stops, 
+   *               or UINT32_MAX to stop by the failure-probability of the query
+   */
+  const std::vector<ui32>& query_impl(QueryContext<D>& ctx, const Point<D>& point, int k, float recall, 
+                                      const QueryBudget* budget, QueryLog *log, ui32 target = UINT32_MAX)
+  {
+    const ui32 M = this->maps.size();
+    ctx.reset(M);
+
+    PointMap<D> found(this->points, point, this->distinct_k(k), ctx.resource());  // found : contains the k nearest points found so far and look up of seen points
+    found.set_prefilter(&this->shorts, this->short_slack);
+    found.set_pivots(&this->pivots);
+
+    // Under the yield schedule the hashes and the flip scores of directed cursors are computed in a single pass
+    const bool by_yield = this->schedule == ProbeSchedule::Yield;
     for (ui32 m = 0; m < M; ++m){
-      hash[m] = this->maps[m]->hash(point);
+      ctx.hash[m] = by_yield ? ctx.cursors[m].locate(this->maps[m], point) : this->maps[m]->hash(point);
     }
+
+    if (by_yield) this->probe_by_yield(ctx, point, found, k, recall, budget, log, target);
+    else          this->probe_lockstep(ctx, point, found, k, recall, budget, log, target);
+
+    found.extract_k_nearest(ctx.result, ctx.dists);
+    this->to_external(ctx.result, &ctx.dists, k);
+    return ctx.result;
+  }
+
+  /**
+   * @brief Probes the maps in lockstep, such that every map probes the bucket at the same (hdist, mask_index) 
+   *        before any map moves on. The buckets of a step are scanned in BATCH_SIZE slices in round-robin order.
+   *        Summarized buckets that cannot hold a point closer than the kth distance are skipped.
+   */
+  void probe_lockstep(QueryContext<D>& ctx, const Point<D>& point, PointMap<D>& found, int k, float recall, 
+                      const QueryBudget* budget, QueryLog *log, ui32 target)
+  {
+    const ui32 M = this->maps.size(), 
+               BATCH_SIZE = this->get_batch_size(k, recall, target);
     
+    auto& hash = ctx.hash;     // hash[m] : contains the hash of point in map[m]
+    auto& bucket = ctx.bucket; // bucket[m] : view of the bucket currently probed in map[m]
+
+    const auto start = std::chrono::steady_clock::now();
+    std::pair<ui32, ui32> emitted(0, UINT32_MAX); // (size, kth distance) of the last result passed to budget->on_progress
+
     // Loop through all buckets within hamming distance of hdist of point
     ui32 hdist = 0, mask_index = 0, buckets = 0;
     while (hdist < this->depth) 
     {
       ui32 hi = found.get_kth_dist();
-      std::vector<ui32> bucket[M];
-      std::queue<std::pair<ui32,ui32>> bucket_q; // bucket_q : contains the indices of the points in bucket[m] that are not in found
+      auto& bucket_q = ctx.slices; // bucket_q : contains the indices of the points in bucket[m] that are not in found
       for (ui32 m = 0; m < M; ++m)
       {
-        ui32 bucket_index = maps[m]->next_bucket(hash[m], hdist, mask_index);
-        bucket[m] = (*maps[m])[bucket_index];
+        hash_idx bucket_index = maps[m]->next_bucket(hash[m], hdist, mask_index);
+        const BucketSummary<D>* summary = maps[m]->summary(bucket_index);
+        if (summary && summary->lower_bound(point) >= found.threshold()) {
+          bucket[m] = bucket_view();
+          ctx.sketches[m] = {};
+        } else {
+          bucket[m] = (*maps[m])[bucket_index];
+          ctx.sketches[m] = maps[m]->inlined(bucket_index);
+        }
         bucket_q.emplace(m, 0);
       }
         
@@ -152,10 +742,12 @@ public:
         auto [m, j] = bucket_q.front();
         bucket_q.pop();
 
-        const ui32 end_idx = std::min(j + BATCH_SIZE, (ui32) bucket[m].size());
+        ui32 end_idx = std::min(j + BATCH_SIZE, (ui32) bucket[m].size());
+        // never compute more distances than the candidate budget allows
+        end_idx = std::min(end_idx, j + this->candidates_left(target, budget, found, k));
 
         // add points from bucket[m][j..j+BATCH_SIZE]
-        found.insert(bucket[m].begin()+j, bucket[m].begin() + end_idx);
+        this->scan(found, bucket[m], ctx.sketches[m], j, end_idx);
         
         // add the next batch from bucket to bucket_q if there is one
         if (end_idx < bucket[m].size()) 
@@ -163,23 +755,17 @@ public:
           bucket_q.emplace(m, end_idx);
         }
 
-        // If we have a new kth distance and we have checked atleast M batches, then we check if we should stop
-        if (i >= M && (hi != found.get_kth_dist()) && stop_query(recall, log2(buckets), found.size(), k, found.get_kth_dist()))
+        // Stop if the budget ran out, or if the stop rule of the forest is met
+        const bool exhausted = this->check_budget(budget, found, k, start, emitted);
+        if (exhausted || stop_slice(target, i, hi, recall, buckets, found, k))
         {
-          hi = found.get_kth_dist();
-          if (log) {
-            log->mask_index = mask_index;
-            log->hdist = hdist;
-            log->found = found.size();
-            log->visited = buckets;
-          }
-
-          return found.extract_k_nearest();
+          write_log(log, mask_index, hdist, found.size(), buckets, exhausted);
+          return;
         }
       }
 
       // Extra stop in-case we need to stop because of hdist
-      if (stop_query(recall, log2(buckets), found.size(), k, found.get_kth_dist()))
+      if (stop_step(target, recall, buckets, found, k))
         break;
 
       // If one map has next bucket they all do, so we just check for an arbitrary map
@@ -190,19 +776,399 @@ public:
       buckets++;
     }
 
-    if (log) {
-      log->mask_index = mask_index;
-      log->hdist = hdist;
-      log->found = found.size();
-      log->visited = buckets;
+    write_log(log, mask_index, hdist, found.size(), buckets, false);
+  }
+
+  /**
+   * @brief Probes the maps through a single heap of the next slice of every map, ordered by the estimated 
+   *        yield of new near neighbours per distance computation. Maps progress through their buckets 
+   *        independently, such that maps whose scans rarely improve the result fall behind.
+   *        Every M completed buckets count as one step of the lockstep schedule for the stop rule.
+   *        ctx.hash must have been computed by ProbeCursor::locate of ctx.cursors.
+   */
+  void probe_by_yield(QueryContext<D>& ctx, const Point<D>& point, PointMap<D>& found, int k, float recall, 
+                      const QueryBudget* budget, QueryLog *log, ui32 target)
+  {
+    const ui32 M = this->maps.size(), 
+               BATCH_SIZE = this->get_batch_size(k, recall, target);
+
+    auto& cursors = ctx.cursors;
+    auto& heap = ctx.probes;
+    for (ui32 m = 0; m < M; ++m) {
+      cursors[m].start(this->maps[m], point, ctx.hash[m], true);
+      if (!cursors[m].exhausted()) heap.emplace_back(this->probe_yield(cursors[m], BATCH_SIZE), m);
+    }
+    std::make_heap(ALL(heap));
+
+    const auto start = std::chrono::steady_clock::now();
+    std::pair<ui32, ui32> emitted(0, UINT32_MAX); // (size, kth distance) of the last result passed to budget->on_progress
+
+    // probes : number of completed buckets, i : slices scanned since the last completed step
+    ui32 probes = 0, i = 0, hi = found.get_kth_dist(), m = 0;
+    while (!heap.empty())
+    {
+      std::pop_heap(ALL(heap));
+      m = heap.back().second;
+      heap.pop_back();
+
+      // Scan the next slice of map m, never computing more distances than the candidate budget allows.
+      // The rest of a summarized bucket is skipped once its points cannot beat the kth distance.
+      ProbeCursor<D>& cursor = cursors[m];
+      bool completed = cursor.bound >= found.threshold();
+      if (completed) {
+        cursor.next_bucket();
+      } else {
+        const ui32 n = std::min({ BATCH_SIZE, cursor.remaining(), this->candidates_left(target, budget, found, k) }),
+                   admitted = this->scan(found, cursor.bucket, cursor.sketches, cursor.offset, cursor.offset + n);
+        completed = cursor.consume(n, admitted);
+      }
+
+      if (!cursor.exhausted()) {
+        heap.emplace_back(this->probe_yield(cursor, BATCH_SIZE), m);
+        std::push_heap(ALL(heap));
+      }
+
+      // Stop if the budget ran out, or if the stop rule of the forest is met
+      const bool exhausted = this->check_budget(budget, found, k, start, emitted);
+      if (exhausted || stop_slice(target, i++, hi, recall, probes / M, found, k)) {
+        write_log(log, cursor.mask_index, cursor.hdist, found.size(), probes / M, exhausted);
+        return;
+      }
+
+      // Extra stop in-case we need to stop because of hdist
+      if (completed && ++probes % M == 0) {
+        if (stop_step(target, recall, probes / M - 1, found, k)) break;
+        hi = found.get_kth_dist();
+        i = 0;
+      }
+    }
+
+    write_log(log, cursors[m].mask_index, cursors[m].hdist, found.size(), probes / M, false);
+  }
+
+  /**
+   * @brief Estimates the number of new near neighbours per distance computation in the next slice of @cursor.
+   *        Near neighbours are less likely to be found in buckets further from the bucket of the query, and 
+   *        in large buckets whose keys are shared by many points. Maps whose scanned points rarely entered 
+   *        the k nearest points of the query are estimated to keep doing so.
+   */
+  inline float probe_yield(const ProbeCursor<D>& cursor, ui32 BATCH_SIZE) const noexcept {
+    const float contribution = (cursor.admitted + 1.0f) / (cursor.scanned + 2.0f),
+                locality = std::pow(YIELD_HDIST_DECAY, (float) cursor.hdist),
+                selectivity = 1.0f / (1.0f + std::log2(1.0f + cursor.bucket.size() / (float) BATCH_SIZE));
+    return contribution * locality * selectivity;
+  }
+
+  /**
+   * @returns The number of distances a query may still compute under its calibrated @target and @budget
+   */
+  inline ui32 candidates_left(ui32 target, const QueryBudget* budget, const PointMap<D>& found, ui32 k) const noexcept {
+    // The calibrated target never stops a query before it holds k points
+    const ui32 calibrated = found.kept() < this->distinct_k(k) ? UINT32_MAX : target;
+    const ui32 limit = std::min(calibrated, budget ? budget->candidates : UINT32_MAX);
+    return limit - std::min(limit, found.size());
+  }
+
+  /**
+   * @brief Passes improved results to the progress callback of @budget, in external ids. A result improves when 
+   *        it holds more points, since the kth distance rises while the k nearest fill up, or when its kth distance drops.
+   * @param emitted The size and kth distance of the last result passed to the callback
+   * @returns True if the @budget ran out
+   */
+  bool check_budget(const QueryBudget* budget, PointMap<D>& found, ui32 k,
+                    std::chrono::steady_clock::time_point start, std::pair<ui32, ui32>& emitted) const 
+  {
+    if (!budget) return false;
+    if (budget->on_progress && (found.kept() > emitted.first || found.get_kth_dist() < emitted.second)) {
+      emitted = { found.kept(), found.get_kth_dist() };
+      std::vector<ui32> snapshot = found.k_nearest();
+      this->to_external(snapshot, nullptr, k);
+      budget->on_progress(snapshot);
     }
+    return found.size() >= budget->candidates 
+        || std::chrono::steady_clock::now() - start >= budget->time;
+  }
 
-    return found.extract_k_nearest();
+  static inline void write_log(QueryLog* log, ui32 mask_index, ui32 hdist, ui32 found, ui32 visited, bool exhausted) {
+    if (!log) return;
+    log->mask_index = mask_index;
+    log->hdist = hdist;
+    log->found = found;
+    log->visited = visited;
+    log->exhausted = exhausted;
   }
 
-  const Point<D> &operator[](ui32 i) const noexcept { return points[i]; };
+  /**
+   * @brief A bucket probed by one or more queries of a block during a single probe step
+   */
+  struct ProbeGroup {
+    bucket_view bucket;        // the probed bucket
+    std::span<const Point<D>> sketches; // inlined copies of the points of bucket, if any
+    const BucketSummary<D>* summary;    // the summary of bucket, if any
+    std::vector<ui32> queries; // block-local indices of the queries that probe the bucket
+    ui32 offset = 0;           // index of the first point in bucket that has not been scanned
+  };
+
+  /**
+   * @brief Answers the queries in @queries[beg..end) and writes their results to @results[beg..end)
+   * @param target Calibrated number of candidates after which a query stops, 
+   *               or UINT32_MAX to stop by the failure-probability of the query
+   */
+  void query_block(const std::vector<Point<D>>& queries, ui32 beg, ui32 end, int k, float recall, ui32 target,
+                   std::vector<std::vector<ui32>>& results)
+  {
+    const ui32 Q = end - beg, 
+               M = this->maps.size(),
+               BATCH_SIZE = this->get_batch_size(k, recall, target);
+
+    std::vector<PointMap<D>> found; // found[q] : contains the k nearest points found so far for queries[beg+q]
+    found.reserve(Q);
+
+    std::vector<std::vector<hash_idx>> hash(Q, std::vector<hash_idx>(M)); // hash[q][m] : hash of queries[beg+q] in map[m]
+    for (ui32 q = 0; q < Q; ++q) {
+      found.emplace_back(this->points, queries[beg + q], this->distinct_k(k));
+      found.back().set_prefilter(&this->shorts, this->short_slack);
+      found.back().set_pivots(&this->pivots);
+      for (ui32 m = 0; m < M; ++m) {
+        hash[q][m] = this->maps[m]->hash(queries[beg + q]);
+      }
+    }
+
+    std::vector<ui32> active(Q), // block-local indices of queries that have not stopped
+                      hi(Q),     // hi[q] : kth distance of query q at the start of the probe step
+                      slices(Q); // slices[q] : number of slices scanned by query q in the probe step
+    std::vector<bool> done(Q, false);
+    std::iota(ALL(active), 0);
+
+    std::vector<std::pair<hash_idx, ui32>> probes; // (bucket index, query) pairs of a single map
+    std::vector<ProbeGroup> groups;
+
+    ui32 hdist = 0, mask_index = 0, buckets = 0;
+    while (hdist < this->depth && !active.empty())
+    {
+      // Group the probes of all active queries by (map, bucket)
+      groups.clear();
+      for (ui32 m = 0; m < M; ++m)
+      {
+        probes.clear();
+        for (auto& q : active) {
+          probes.emplace_back(this->maps[m]->next_bucket(hash[q][m], hdist, mask_index), q);
+        }
+        std::sort(ALL(probes));
+
+        for (ui32 i = 0; i < probes.size(); ++i) {
+          if (!i || probes[i].first != probes[i-1].first) {
+            groups.push_back({ (*this->maps[m])[probes[i].first], this->maps[m]->inlined(probes[i].first), 
+                               this->maps[m]->summary(probes[i].first), {}, 0 });
+          }
+          groups.back().queries.push_back(probes[i].second);
+        }
+      }
+
+      for (auto& q : active) {
+        hi[q] = found[q].get_kth_dist();
+        slices[q] = 0;
+      }
+
+      // Scan BATCH_SIZE slices of the grouped buckets in round-robin order, sharing every slice between 
+      // the queries of the group. Queries that decide to stop are removed from the remaining groups.
+      std::queue<ui32> group_q;
+      for (ui32 g = 0; g < groups.size(); ++g) {
+        group_q.push(g);
+      }
+
+      while (!group_q.empty())
+      {
+        ProbeGroup& group = groups[group_q.front()];
+        group_q.pop();
+
+        std::erase_if(group.queries, [&done](ui32 q) { return done[q]; });
+        // Queries skip the summarized buckets that cannot hold a point closer than their kth distance
+        if (group.summary && group.offset == 0) {
+          std::erase_if(group.queries, [&](ui32 q) { 
+            return group.summary->lower_bound(queries[beg + q]) >= found[q].threshold(); 
+          });
+        }
+        if (group.queries.empty()) continue;
+
+        const ui32 end_idx = std::min(group.offset + BATCH_SIZE, (ui32) group.bucket.size());
+        for (ui32 j = group.offset; j < end_idx; ++j) {
+          if (group.sketches.empty()) {
+            for (auto& q : group.queries) found[q].insert(group.bucket[j]);
+          } else {
+            for (auto& q : group.queries) found[q].insert(group.bucket[j], group.sketches[j]);
+          }
+        }
+        
+        group.offset = end_idx;
+        if (end_idx < group.bucket.size()) {
+          group_q.push(&group - groups.data());
+        }
+
+        for (auto& q : group.queries) {
+          if (stop_slice(target, slices[q]++, hi[q], recall, buckets, found[q], k)) {
+            done[q] = true;
+          }
+        }
+      }
+
+      // Extra stop in-case a query needs to stop because of hdist
+      for (auto& q : active) {
+        if (!done[q] && stop_step(target, recall, buckets, found[q], k)) {
+          done[q] = true;
+        }
+      }
+      std::erase_if(active, [&done](ui32 q) { return done[q]; });
+
+      // If one map has next bucket they all do, so we just check for an arbitrary map
+      if (!this->maps[0]->has_next_bucket(hash[0][0], hdist, ++mask_index)) {
+        ++hdist;
+        mask_index = 0;
+      }
+      buckets++;
+    }
+
+    for (ui32 q = 0; q < Q; ++q) {
+      results[beg + q] = found[q].extract_k_nearest();
+      this->to_external(results[beg + q], nullptr, k);
+    }
+  }
+
+  /**
+   * @brief Inserts the points of @bucket[beg..end) into @found, reading their inlined copies in @sketches if the 
+   *        bucket is inlined and fetching them from the point store otherwise
+   * @returns The number of inserted points that entered the k nearest points
+   */
+  static inline ui32 scan(PointMap<D>& found, bucket_view bucket, std::span<const Point<D>> sketches, ui32 beg, ui32 end) noexcept {
+    if (sketches.empty()) return found.insert(bucket.begin() + beg, bucket.begin() + end);
+    return found.insert(bucket.subspan(beg, end - beg), sketches.subspan(beg, end - beg));
+  }
+
+  /**
+   * @brief Copies the points of the buckets selected by set_inline_points into their maps, and summarizes 
+   *        the buckets selected by set_bucket_summaries. Drops the copies and summaries of the other maps.
+   */
+  void refresh_buckets() {
+    ThreadPool::instance().parallel_for(0, this->maps.size(), 1, [this](ui32 m) {
+      if (m < this->inline_maps) this->maps[m]->inline_points(this->points, this->inline_min_size);
+      else                       this->maps[m]->clear_inlined();
+
+      if (this->summary_min_size <= this->summary_max_size) {
+        this->maps[m]->summarize_buckets(this->points, this->summary_min_size, this->summary_max_size);
+      } else {
+        this->maps[m]->clear_summaries();
+      }
+    });
+  }
+
+  /**
+   * @brief Replaces the indices of the points in @result by their external ids. A deduplicated point is expanded 
+   *        into all of its external ids, such that @result holds at most @k ids in ascending order by distance.
+   * @param dists dists[i] : distance of result[i], expanded alongside @result if not null
+   */
+  void to_external(std::vector<ui32>& result, std::vector<ui32>* dists, ui32 k) const {
+    if (ids.empty() || result.empty()) return;
+
+    // The first n points of result expand into total ids
+    ui32 n = 0, total = 0;
+    while (n < result.size() && total < k) {
+      total += offsets[result[n] + 1] - offsets[result[n]];
+      ++n;
+    }
+    const ui32 last_size = offsets[result[n-1] + 1] - offsets[result[n-1]],
+               size = std::min(total, k);
+
+    // Expand in place from the back, point i is written to positions at or after i
+    result.resize(std::max(size, (ui32) result.size()));
+    if (dists) dists->resize(result.size());
+    for (ui32 i = n, w = size; i-- > 0;) {
+      const ui32 pidx = result[i], d = dists ? (*dists)[i] : 0,
+                 cnt = i == n - 1 ? last_size - (total - size) : offsets[pidx + 1] - offsets[pidx];
+      w -= cnt;
+      std::copy(ids.begin() + offsets[pidx], ids.begin() + offsets[pidx] + cnt, result.begin() + w);
+      if (dists) std::fill(dists->begin() + w, dists->begin() + w + cnt, d);
+    }
+    result.resize(size);
+    if (dists) dists->resize(size);
+  }
+
+  /**
+   * @returns The number of distinct points a query for the @k nearest points collects, 
+   *          which is less than @k if the forest holds less than @k distinct points
+   */
+  inline ui32 distinct_k(ui32 k) const noexcept { return std::min(k, (ui32) this->points.size()); }
+
+  /**
+   * @brief Stores the points at the indices in @order in that order, where the point stored at index j takes over 
+   *        the external ids of the points at the indices in @merged(j), and rebuilds the maps on the stored points
+   * @param merged Returns a range of indices for every index in @order
+   */
+  template<typename Merged>
+  void renumber(const std::vector<ui32>& order, Merged merged) {
+    const ui32 U = order.size(), N = this->size();
+    PointStore<D> next(this->points.get_config());
+    next.reserve(U);
+    std::vector<ui32> next_ids, next_offsets(1, 0);
+    next_ids.reserve(N);
+    next_offsets.reserve(U + 1);
+    for (ui32 j = 0; j < U; ++j) {
+      next.push_back(this->points[order[j]]);
+      for (ui32 i : merged(j)) {
+        if (ids.empty()) next_ids.push_back(i);
+        else             next_ids.insert(next_ids.end(), ids.begin() + offsets[i], ids.begin() + offsets[i + 1]);
+      }
+      next_offsets.push_back(next_ids.size());
+    }
+    assert(next_ids.size() == N);
+
+    this->positions.resize(N);
+    for (ui32 j = 0; j < U; ++j) {
+      for (ui32 a = next_offsets[j]; a < next_offsets[j + 1]; ++a) this->positions[next_ids[a]] = j;
+    }
+    this->points = std::move(next);
+    this->ids = std::move(next_ids);
+    this->offsets = std::move(next_offsets);
+    if (shorts.bits()) shorts.assign(this->points);
+    if (pivots.count()) pivots.assign(this->points);
+
+    if (cache) cache->invalidate();
+    ThreadPool::instance().parallel_for(0, this->maps.size(), 1, [this](ui32 m) {
+      this->maps[m]->build(this->maps[m]->hashes);
+      this->maps[m]->add(this->points);
+    });
+    this->refresh_buckets();
+  }
+
+  /**
+   * @brief Returns the number of points scanned from a bucket at a time. Calibrated queries
+   *        split their candidate @target evenly between the maps.
+   */
+  inline ui32 get_batch_size(ui32 k, float recall, ui32 target) const noexcept {
+    if (target == UINT32_MAX) return k * this->get_bucket_factor(recall);
+    return std::max(k, target / (ui32) this->maps.size());
+  }
+
+  /**
+   * @brief Returns true if a query should stop after scanning its @i'th slice of the current probe step
+   * @param target Calibrated number of candidates, or UINT32_MAX to use the failure-probability
+   * @param hi The kth distance of the query at the start of the probe step
+   */
+  inline bool stop_slice(ui32 target, ui32 i, ui32 hi, float recall, ui32 buckets, const PointMap<D>& found, ui32 k) const {
+    if (target != UINT32_MAX) return found.size() >= target && found.kept() >= this->distinct_k(k);
+
+    // If we have a new kth distance and we have checked atleast M batches, then we check if we should stop
+    return i >= this->maps.size() && hi != found.get_kth_dist() 
+        && stop_query(recall, log2(buckets), found.size(), k, found.get_kth_dist());
+  }
+
+  /**
+   * @brief Returns true if a query should stop after completing a probe step
+   */
+  inline bool stop_step(ui32 target, float recall, ui32 buckets, const PointMap<D>& found, ui32 k) const {
+    if (target != UINT32_MAX) return found.size() >= target && found.kept() >= this->distinct_k(k);
+    return stop_query(recall, log2(buckets), found.size(), k, found.get_kth_dist());
+  }
 
-private:
   /**
    * @brief Returns true if the kNN-query should stop
    * @param recall A decimal value between 0 and 1 indicating 
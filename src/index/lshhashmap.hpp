@@ -3,7 +3,13 @@
 #include "lshmap.hpp"
 #include "bucketmask.hpp"
 
-template <ui32 D>
+/**
+ * @brief An LSHMap storing only its non-empty buckets in a hash table
+ * @tparam D dimension of the points
+ * @tparam Key type of the stored bucket keys, must hold the hashes of the chain. 
+ *             32-bit keys keep the table compact for chains of up to 32 hash functions.
+ */
+template <ui32 D, typename Key = ui32>
 class LSHHashMap : public LSHMap<D> {
 
 public:
@@ -33,13 +39,15 @@ public:
    * @param hf The hashfamily to build the map with
    */
   void build(HashFamily<D>& hf) {
+    assert(hf.size() <= 8 * sizeof(Key) && hf.size() <= MAX_CHAIN_DEPTH);
     this->hashes = hf;
 
     this->buckets.clear();
+    this->invalidate_buckets();
     this->max_bucket_size = 0;
     count = 0;
     
-    this->number_virtual_buckets = 1ULL << this->hashes.size();
+    this->number_virtual_buckets = this->hashes.size() < 64 ? 1ULL << this->hashes.size() : UINT64_MAX;
   }
 
   /**
@@ -55,7 +63,7 @@ public:
   /**
    * @returns Number of buckets in the map
    */
-  ui32 bucketCount() const { return this->number_virtual_buckets; };
+  ui64 bucketCount() const { return this->number_virtual_buckets; };
 
   /**
    * @brief Inserts a point into the map
@@ -63,13 +71,14 @@ public:
   void add(const Point<D> &point) {
     const hash_idx index = this->hash(point);
     
+    this->invalidate_buckets();
     buckets[index].emplace_back(count++);
   };
 
   /**
-   * @brief Inserts a vector of points into the map
+   * @brief Inserts a range of points into the map
    */
-  void add(std::vector<Point<D>> &points) {
+  void add(std::span<const Point<D>> points) {
     for (const auto& p : points) {
       this->add(p);
     }
@@ -143,22 +152,46 @@ public:
   };
 
   /**
-   * @brief Retrieve the bucket at the specified bucket-index
+   * @brief Retrieve a view of the bucket at the specified bucket-index
    */
-  bucket& operator[](hash_idx bidx) {
+  bucket_view operator[](hash_idx bidx) const {
     // Return empty bucket if the bucket does not exist
-    if (!this->buckets.contains(bidx)) {
-      return this->empty_bucket;
+    auto it = this->buckets.find((Key) bidx);
+    if (it == this->buckets.end()) {
+      return bucket_view();
     }
     
-    return this->buckets[bidx];
+    return it->second;
+  }
+
+  /**
+   * @brief Calls @fn with the index and a view of every non-empty bucket
+   */
+  void for_each_bucket(const std::function<void(hash_idx, bucket_view)>& fn) const {
+    for (const auto& [ bidx, b ] : this->buckets) {
+      if (!b.empty()) fn(bidx, b);
+    }
   }
   
 private:
-  std::unordered_map<hash_idx, bucket> buckets;
-  bucket empty_bucket;
+  std::unordered_map<Key, bucket> buckets;
   ui64 count;
-  ui32 number_virtual_buckets;
+  ui64 number_virtual_buckets;
   // all possible masks by hamming distance 
   BucketMask masks;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Creates an LSHHashMap over @hf, keyed by 32-bit integers if its chain fits and by 64-bit integers otherwise
+ */
+template <ui32 D>
+inline LSHMap<D>* make_lsh_hash_map(HashFamily<D>& hf, BucketMask& masks) {
+  if (hf.size() <= 32) return new LSHHashMap<D, ui32>(hf, masks);
+  return new LSHHashMap<D, ui64>(hf, masks);
+}
+
+template <ui32 D>
+inline LSHMap<D>* make_lsh_hash_map(HashFamily<D>& hf) {
+  if (hf.size() <= 32) return new LSHHashMap<D, ui32>(hf);
+  return new LSHHashMap<D, ui64>(hf);
+}
@@ -1,13 +1,49 @@
 #pragma once
 
+#include <functional>
+#include <span>
+#include <unordered_map>
+
 #include "index.hpp"
+#include "pointstore.hpp"
 #include "../hash/hashfamily.hpp"
 
 typedef std::vector<ui32> bucket; // index bucket
-typedef ui32 hash_idx;
+typedef std::span<const ui32> bucket_view; // non-owning view of an index bucket
+typedef ui64 hash_idx; // bucket key, maps store their keys in the narrowest type that holds their chain
+
+// Maximum number of hash functions in the chain of a map, limited by the width of hash_idx
+constexpr ui32 MAX_CHAIN_DEPTH = 64;
+
+/**
+ * @brief The bits shared by all points of a bucket, from which a lower bound on the distance of a query 
+ *        to any point of the bucket follows without reading the points
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+struct BucketSummary {
+  Point<D> all, // the AND of the points of the bucket
+           any; // the OR of the points of the bucket
+
+  /**
+   * @returns The number of bits in which every point of the bucket differs from @query, 
+   *          which is at most the distance of @query to any point of the bucket
+   */
+  inline ui32 lower_bound(const Point<D>& query) const noexcept {
+    return ((all & ~query) | (~any & query)).count();
+  }
+};
 
 template<ui32 D>
 class LSHMap {
+  // summaries[summarized[bidx]] : the summary of bucket bidx
+  std::vector<BucketSummary<D>> summaries;
+  std::unordered_map<hash_idx, ui32> summarized;
+
+  // Copies of the points of the inlined buckets, bucket after bucket in the order of their ids
+  PointStore<D> inlined_points;
+  // inlined_buckets[bidx] : (offset in inlined_points, size) of the copies of bucket bidx
+  std::unordered_map<hash_idx, std::pair<ui64, ui32>> inlined_buckets;
 
 public:
   HashFamily<D> hashes;
@@ -15,6 +51,8 @@ public:
   
   LSHMap(HashFamily<D>& hashFamily) : hashes(hashFamily) {}
 
+  virtual ~LSHMap() = default;
+
   virtual void build(HashFamily<D>& hashFamily) = 0;
   
   /**
@@ -33,9 +71,9 @@ public:
   virtual ui32 depth() const = 0;
 
   /**
-   * @returns Number of buckets in the map
+   * @returns Number of buckets in the map, saturated at UINT64_MAX for chains of MAX_CHAIN_DEPTH hash functions
    */
-  virtual ui32 bucketCount() const = 0;
+  virtual ui64 bucketCount() const = 0;
 
   /**
    * Inserts a point into the map
@@ -43,9 +81,9 @@ public:
   virtual void add(const Point<D> &point) = 0;
 
   /**
-   * Inserts a vector of points into the map
+   * Inserts a range of points into the map
    */
-  virtual void add(std::vector<Point<D>> &points) = 0;
+  virtual void add(std::span<const Point<D>> points) = 0;
 
   /**
    * @returns The hash (index) of the bucket the point belongs to
@@ -80,8 +118,107 @@ public:
   virtual std::vector<hash_idx> query(hash_idx bidx, ui32 hdist = 0) const = 0;
 
   /**
-   * @returns Returns the bucket at index bidx
+   * @returns Returns a view of the bucket at index bidx. 
+   *          The view is invalidated when points are added to the map or the map is rebuilt.
+   */
+  virtual bucket_view operator[](hash_idx bidx) const = 0;
+
+  /**
+   * @brief Calls @fn with the index and a view of every non-empty bucket of the map
+   */
+  virtual void for_each_bucket(const std::function<void(hash_idx, bucket_view)>& fn) const = 0;
+
+  /**
+   * @brief Stores copies of the points of every bucket of at least @min_size points next to its ids, 
+   *        such that scanning the bucket reads its points sequentially instead of fetching every 
+   *        point from @points at random. The copies are dropped when points are added or the map is rebuilt.
+   * @param points The points indexed by the ids in the buckets of the map
+   * @param min_size The minimum size of an inlined bucket, 1 inlines every bucket
+   */
+  void inline_points(std::span<const Point<D>> points, ui32 min_size) {
+    this->clear_inlined();
+    ui64 total = 0;
+    this->for_each_bucket([&](hash_idx, bucket_view b) { if (b.size() >= min_size) total += b.size(); });
+    inlined_points.reserve(total);
+
+    this->for_each_bucket([&](hash_idx bidx, bucket_view b) {
+      if (b.size() < min_size) return;
+      inlined_buckets.emplace(bidx, std::make_pair(inlined_points.size(), (ui32) b.size()));
+      for (auto pidx : b) inlined_points.push_back(points[pidx]);
+    });
+  }
+
+  /**
+   * @returns A view of the copies of the points of the bucket at index @bidx, aligned with the ids of the bucket,
+   *          or an empty view if the bucket is not inlined
+   */
+  inline std::span<const Point<D>> inlined(hash_idx bidx) const {
+    if (inlined_buckets.empty()) return {};
+    auto it = inlined_buckets.find(bidx);
+    if (it == inlined_buckets.end()) return {};
+    return std::span<const Point<D>>(inlined_points.data() + it->second.first, it->second.second);
+  }
+
+  /**
+   * @brief Drops the inlined copies of the points, they are stale once the buckets change
+   */
+  inline void clear_inlined() noexcept {
+    if (inlined_buckets.empty()) return;
+    inlined_buckets.clear();
+    inlined_points.clear();
+  }
+
+  /**
+   * @brief Computes the AND and OR of the points of every bucket whose size is in [@min_size, @max_size], 
+   *        see BucketSummary. Summaries of large buckets of unrelated points are all-zero AND and all-one OR,
+   *        which bound nothing. The summaries are dropped when points are added or the map is rebuilt.
+   * @param points The points indexed by the ids in the buckets of the map
+   */
+  void summarize_buckets(std::span<const Point<D>> points, ui32 min_size, ui32 max_size = UINT32_MAX) {
+    this->clear_summaries();
+    this->for_each_bucket([&](hash_idx bidx, bucket_view b) {
+      if (b.size() < min_size || b.size() > max_size) return;
+      BucketSummary<D> s{ points[b.front()], points[b.front()] };
+      for (auto pidx : b) {
+        s.all &= points[pidx];
+        s.any |= points[pidx];
+      }
+      summarized.emplace(bidx, summaries.size());
+      summaries.push_back(s);
+    });
+  }
+
+  /**
+   * @returns The summary of the bucket at index @bidx, or nullptr if the bucket is not summarized
+   */
+  inline const BucketSummary<D>* summary(hash_idx bidx) const {
+    if (summarized.empty()) return nullptr;
+    auto it = summarized.find(bidx);
+    return it == summarized.end() ? nullptr : &summaries[it->second];
+  }
+
+  /**
+   * @returns Number of bytes used by the summaries of the buckets
+   */
+  inline ui64 summary_bytes() const noexcept { return summaries.size() * sizeof(BucketSummary<D>); }
+
+  inline void clear_summaries() noexcept {
+    if (summarized.empty()) return;
+    summarized.clear();
+    summaries.clear();
+  }
+
+  /**
+   * @brief Drops the inlined copies and summaries of the buckets, they are stale once the buckets change
+   */
+  inline void invalidate_buckets() noexcept {
+    this->clear_inlined();
+    this->clear_summaries();
+  }
+
+  /**
+   * @returns Number of bytes used by the inlined copies of the points
    */
-  virtual bucket& operator[](hash_idx bidx) = 0;
+  inline ui64 inlined_bytes() const noexcept { return inlined_points.size() * sizeof(Point<D>); }
 };
 
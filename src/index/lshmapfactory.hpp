@@ -1,13 +1,14 @@
 #pragma once
 
 #include "../hash/hashfamily.hpp"
+#include "../hash/supervisedhashfamilyfactory.hpp"
 #include "lsharraymap.hpp"
 #include "bucketmask.hpp"
 #include "lshhashmap.hpp"
 #include "lshmapprioqueue.hpp"
 #include "../statistics/lshmapanalyzer.hpp"
 #include "../util/ranges.hpp"
-#include <thread>
+#include "../util/threadpool.hpp"
 
 template<ui32 D> 
 class LSHMapFactory {
@@ -18,7 +19,7 @@ public:
 
   static LSHMap<D>* create(HashFamily<D>& H, BucketMask &masks, ui32 depth) {
     auto hf = H.subset(depth);
-    return new LSHHashMap<D>(hf, masks);
+    return make_lsh_hash_map<D>(hf, masks);
   }
 
   /** 
@@ -34,19 +35,40 @@ public:
     std::vector<LSHMap<D>*> ret;
     
     for (ui32 i = 0; i < k; ++i) {
-      auto hf = HashFamily<D>(
-        subset.begin() + i * depth,
-        subset.begin() + (i + 1) * depth
-      );
+      auto hf = subset.slice(i * depth, (i + 1) * depth);
 
       ret.push_back(
-        new LSHHashMap<D>(hf, masks)
+        make_lsh_hash_map<D>(hf, masks)
       );
     }
 
     return ret;
   }
   
+  /**
+   * @brief Construct @k LSHMaps with @depth hash functions chosen from @H to keep near neighbours in shared buckets,
+   *        see SupervisedHashFamilyFactory::create
+   * @param sample A sample of the points to index, used to keep the buckets balanced
+   * @param pairs (query, near neighbour) pairs, see SupervisedHashFamilyFactory::knn_pairs
+   */
+  static std::vector<LSHMap<D>*> create_supervised(const std::vector<Point<D>>& sample,
+                                                   const std::vector<std::pair<Point<D>, Point<D>>>& pairs,
+                                                   const HashFamily<D>& H, 
+                                                   ui32 depth, 
+                                                   ui32 k,
+                                                   double balance = SupervisedHashFamilyFactory<D>::DEFAULT_BALANCE)
+  {
+    BucketMask masks(depth);
+    HashFamily<D> chains = SupervisedHashFamilyFactory<D>::create(sample, pairs, H, depth, k, balance);
+
+    std::vector<LSHMap<D>*> ret;
+    for (ui32 i = 0; i < k; ++i) {
+      auto hf = chains.slice(i * depth, (i + 1) * depth);
+      ret.push_back(make_lsh_hash_map<D>(hf, masks));
+    }
+    return ret;
+  }
+
   /**
    * @brief Construct k LSHMaps with @depth hashfunctions chosen at random from @H by rebuilding @steps times
   */
@@ -110,7 +132,7 @@ public:
   /**
    * @brief Construct @k LSHMaps with @depth hashfunctions chosen from @H
    *        The hash functions are chosen to minimize the size of the largest bucket
-   *        and the building process is handled by multiple threads.
+   *        and the building process is handled by the shared ThreadPool.
    * @param points The input points to build the LSHMaps from
    * @param H The hash family to choose hash functions from
    * @param depth The number of hash functions per LSHMap
@@ -127,17 +149,18 @@ public:
     
     BucketMask masks(depth);
 
-    const ui32 THREAD_CNT = std::thread::hardware_concurrency();
-    const ui32 THREAD_STEPS = std::ceil(k * steps / ((double) THREAD_CNT));
+    ThreadPool& pool = ThreadPool::instance();
+    const ui32 BUILDS = k * steps,
+               CHUNK_SIZE = std::max(1U, BUILDS / (4 * pool.size()));
     LSHMapPriorityQueue<D> mqueue(H, masks, k, depth);
 
 
-    // Each thread builds @THREAD_STEPS LSHMaps from @points
+    // Each task builds the LSHMaps of a chunk of [0, BUILDS) from @points
     // and try to insert them into the priority queue
-    auto build_map = [&mqueue, &points, &depth, &H, &masks, &THREAD_STEPS](int id)
+    auto build_maps = [&mqueue, &points, &depth, &H, &masks](ui32 lo, ui32 hi)
     {
       LSHMap<D> *map = LSHMapFactory<D>::create(H, masks, depth); // Temporary map to find good hash families
-      for (ui32 i = 0; i < THREAD_STEPS; i++)
+      for (ui32 i = lo; i < hi; i++)
       {
         HashFamily<D> hsubset = H.subset(depth);
         map->build(hsubset); // Clears the map and builds it with the new hash family
@@ -147,16 +170,7 @@ public:
       delete map;
     };
 
-    // spawn threads that build_map
-    std::vector<std::thread> pool(THREAD_CNT);
-    for (int i = 0; i < THREAD_CNT; ++i) {
-      pool[i] = std::thread(build_map, i);
-    }
-    
-    // wait for threads to finish
-    for (auto& th : pool) {
-      th.join();
-    }
+    pool.parallel_chunks(0, BUILDS, CHUNK_SIZE, build_maps);
 
     auto ret = mqueue.get_all();
     assert(ret.size() == k);
@@ -41,7 +41,7 @@ public:
     // Initialize queue with max_size maps
     for (ui32 i = 0; i < max_size; ++i) {
       HashFamily<D> hashes = hf.subset(depth); 
-      LSHMap<D>* mp = new LSHHashMap<D>(hashes);
+      LSHMap<D>* mp = make_lsh_hash_map<D>(hashes);
       mp->max_bucket_size = UINT32_MAX;
       pqueue.push_back(mp);
     }
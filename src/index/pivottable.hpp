@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <span>
+
+#include "../global.hpp"
+#include "point.hpp"
+
+/**
+ * @brief The distances of every point of an index to a few dozen pivot points, stored as ui16.
+ *        By the triangle inequality |d(q, pivot) - d(p, pivot)| <= d(q, p) for every pivot, such that
+ *        the largest of these differences bounds the distance of a candidate p from below without reading p.
+ *        With 32 pivots the table holds 64 bytes per point, half a 1024-bit point, in contiguous rows.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class PivotTable {
+  static_assert(D <= UINT16_MAX);
+
+public:
+  // Largest number of pivots
+  static constexpr ui32 MAX_PIVOTS = 64;
+
+  // Default number of pivots
+  static constexpr ui32 DEFAULT_PIVOTS = 32;
+
+  // Number of points sampled by select_pivots
+  static constexpr ui32 SELECT_SAMPLE = 1 << 14;
+
+  // The distances of a single point to the pivots
+  using Row = std::array<ui16, MAX_PIVOTS>;
+
+private:
+  std::vector<Point<D>> pivots;
+  std::vector<ui16> dists; // dists[i * pivots.size() + j] : distance of point i to pivots[j]
+
+public:
+  PivotTable() = default;
+
+  explicit PivotTable(std::vector<Point<D>> pivots) : pivots(std::move(pivots)) {
+    assert(this->pivots.size() <= MAX_PIVOTS);
+  }
+
+  /**
+   * @brief Selects @count pivots from a sample of @points by farthest-first traversal, starting at the first
+   *        sampled point, such that the pivots are spread out and bound far candidates from many directions
+   */
+  static std::vector<Point<D>> select_pivots(std::span<const Point<D>> points, ui32 count) {
+    assert(count <= MAX_PIVOTS);
+    const ui64 stride = std::max<ui64>(1, points.size() / SELECT_SAMPLE);
+    std::vector<const Point<D>*> sample;
+    for (ui64 i = 0; i < points.size(); i += stride) sample.push_back(&points[i]);
+
+    std::vector<Point<D>> ret;
+    std::vector<ui32> nearest(sample.size(), UINT32_MAX); // nearest[s] : distance of sample[s] to the closest pivot
+    ui32 next = 0;
+    while (ret.size() < std::min<ui64>(count, sample.size())) {
+      ret.push_back(*sample[next]);
+      for (ui32 s = 0; s < sample.size(); ++s) {
+        nearest[s] = std::min(nearest[s], sample[s]->distance(ret.back()));
+      }
+      next = std::max_element(ALL(nearest)) - nearest.begin();
+      if (nearest[next] == 0) break; // every sampled point equals a pivot
+    }
+    return ret;
+  }
+
+  /**
+   * @returns Number of pivots, 0 if the table is disabled
+   */
+  inline ui32 count() const noexcept { return pivots.size(); }
+
+  /**
+   * @returns Number of points in the table
+   */
+  inline ui64 size() const noexcept { return pivots.empty() ? 0 : dists.size() / pivots.size(); }
+
+  /**
+   * @returns Number of bytes used by the distances of the points
+   */
+  inline ui64 bytes() const noexcept { return dists.size() * sizeof(ui16); }
+
+  /**
+   * @returns The distances of @p to the pivots
+   */
+  Row project(const Point<D>& p) const noexcept {
+    Row ret{};
+    for (ui32 j = 0; j < pivots.size(); ++j) ret[j] = p.distance(pivots[j]);
+    return ret;
+  }
+
+  /**
+   * @brief Replaces the rows of the table by the distances of @points
+   */
+  void assign(std::span<const Point<D>> points) {
+    dists.clear();
+    dists.reserve(points.size() * pivots.size());
+    for (const auto& p : points) this->push_back(p);
+  }
+
+  /**
+   * @brief Appends the distances of @p
+   */
+  void push_back(const Point<D>& p) {
+    const Row r = this->project(p);
+    dists.insert(dists.end(), r.begin(), r.begin() + pivots.size());
+  }
+
+  /**
+   * @returns A lower bound on the distance between the point with distances @q to the pivots and point @i
+   */
+  inline ui32 lower_bound(const Row& q, ui32 i) const noexcept {
+    const ui32 P = pivots.size();
+    const ui16* row = dists.data() + (ui64) i * P;
+    ui32 bound = 0;
+    for (ui32 j = 0; j < P; ++j) {
+      bound = std::max(bound, (ui32) std::abs((int) q[j] - (int) row[j]));
+    }
+    return bound;
+  }
+};
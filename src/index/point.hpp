@@ -1,14 +1,61 @@
 #pragma once
 
+#include <bit>
 #include <random>
 #include <bitset>
+#include <span>
+#include <utility>
 #include "../global.hpp"
 
 /** Binary vector point */
 template<ui32 D>
 class Point : public std::bitset<D> {
+  /**
+   * @returns The hamming distance of the word arrays @a and @b, as a single unrolled sum over the words
+   */
+  template<size_t... I>
+  static inline ui32 distance_words(const ui64* a, const ui64* b, std::index_sequence<I...>) noexcept {
+    return (std::popcount(a[I] ^ b[I]) + ...);
+  }
+
   public:
     using std::bitset<D>::bitset;
+
+    // Number of 64-bit words in a point
+    static constexpr ui32 WORDS = (D + 63) / 64;
+
+    // Number of words summed between the checks of distance_bounded, 256 bits
+    static constexpr ui32 BLOCK_WORDS = 4;
+
+    // True if the bits of a point are stored as exactly WORDS words, least significant word first,
+    // which holds for the bitsets of the standard library whenever D is a multiple of 64
+    static constexpr bool HAS_WORDS = D % 64 == 0 && sizeof(std::bitset<D>) == WORDS * sizeof(ui64);
+
+    /**
+     * @returns The words of the point, word i holds the bits [64i, 64(i+1)). Requires HAS_WORDS.
+     */
+    inline std::span<const ui64, WORDS> words() const noexcept {
+      static_assert(HAS_WORDS);
+      return std::span<const ui64, WORDS>(reinterpret_cast<const ui64*>(this), WORDS);
+    }
+
+    /**
+     * @brief Constructs a point from the words of a sketch, where the first word holds the most significant bits
+     */
+    static inline Point<D> from_words(std::span<const ui64> in) {
+      assert(in.size() == WORDS);
+      Point<D> ret;
+      if constexpr (HAS_WORDS) {
+        ui64* out = reinterpret_cast<ui64*>(&ret);
+        for (ui32 w = 0; w < WORDS; ++w) out[WORDS - 1 - w] = in[w];
+      } else {
+        for (ui32 w = 0; w < WORDS; ++w) {
+          ret <<= 64;
+          ret |= Point<D>(in[w]);
+        }
+      }
+      return ret;
+    }
     
     Point<D> operator~() const noexcept {
       Point<D> ret(*this);
@@ -18,9 +65,33 @@ class Point : public std::bitset<D> {
 
     /** @brief Computes the Hamming distance between two points */
     inline ui32 distance(const Point<D>& p2) const noexcept {
-      return (*this ^ p2).count();
+      if constexpr (HAS_WORDS) {
+        return distance_words(this->words().data(), p2.words().data(), std::make_index_sequence<WORDS>());
+      } else {
+        return (*this ^ p2).count();
+      }
     }
     
+    /**
+     * @brief Computes the Hamming distance between two points, but gives up once the partial distance
+     *        over the first blocks of BLOCK_WORDS words reaches @bound. Candidates that cannot beat the
+     *        current kth distance of a query are thereby rejected after reading part of the point.
+     * @returns The hamming distance if it is less than @bound, otherwise a value of at least @bound
+     */
+    inline ui32 distance_bounded(const Point<D>& p2, ui32 bound) const noexcept {
+      if constexpr (HAS_WORDS && WORDS > BLOCK_WORDS && WORDS % BLOCK_WORDS == 0) {
+        const ui64 *a = this->words().data(), *b = p2.words().data();
+        ui32 dist = 0;
+        for (ui32 w = 0; w < WORDS; w += BLOCK_WORDS) {
+          dist += distance_words(a + w, b + w, std::make_index_sequence<BLOCK_WORDS>());
+          if (dist >= bound) break;
+        }
+        return dist;
+      } else {
+        return this->distance(p2);
+      }
+    }
+
     /** 
      * @brief Generates a random point from a Bernoulli distribution
      * @param p controls the Bernoulli distribution
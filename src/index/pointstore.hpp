@@ -0,0 +1,202 @@
+#pragma once
+
+#include <cstring>
+#include <new>
+#include <span>
+#include <sys/mman.h>
+#include <type_traits>
+
+#include "../global.hpp"
+#include "point.hpp"
+
+/**
+ * @brief Options of the memory backing a PointStore
+ */
+struct PointStoreConfig {
+  bool huge_pages = true; // back stores of at least HUGE_PAGE_BYTES by huge pages, explicit if available, else transparent
+  bool lock = false;      // mlock the memory of the store, such that it is never paged out
+  bool prefault = false;  // fault in every page when the memory is allocated, instead of on first access
+};
+
+/**
+ * @brief Contiguous storage of the points of an index. Owned memory is allocated with mmap, which
+ *        aligns it to pages and thereby to cache lines, and is backed by huge pages when possible.
+ *        Random access to candidate points at 10M+ points is bound by TLB misses, which huge pages cut
+ *        by a factor of 512. A store may instead borrow external memory, such as a mapped file, without copying.
+ *        Like std::vector, adding points may move the store and invalidates views of it.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class PointStore {
+  static_assert(std::is_trivially_copyable_v<Point<D>>);
+
+  Point<D>* buffer = nullptr;
+  ui64 count = 0,
+       capacity_ = 0;          // number of points that fit in buffer, 0 if buffer is borrowed
+  ui64 mapped = 0;             // number of bytes mapped for buffer, 0 if buffer is borrowed
+  PointStoreConfig config;
+  bool huge = false,           // true if buffer is backed by explicit or transparent huge pages
+       locked = false;         // true if buffer is locked in memory
+
+  void release() noexcept {
+    if (mapped) {
+      if (locked) munlock(buffer, mapped);
+      munmap(buffer, mapped);
+    }
+    buffer = nullptr;
+    count = capacity_ = mapped = 0;
+    huge = locked = false;
+  }
+
+  /**
+   * @brief Moves the points of the store into owned memory holding at least @n points
+   * @throws std::bad_alloc if the memory cannot be mapped
+   */
+  void reallocate(ui64 n) {
+    const bool use_huge = config.huge_pages && n * sizeof(Point<D>) >= HUGE_PAGE_BYTES;
+    const ui64 page = use_huge ? HUGE_PAGE_BYTES : SMALL_PAGE_BYTES,
+               bytes = std::max(page, (n * sizeof(Point<D>) + page - 1) / page * page);
+    const int populate =
+#ifdef MAP_POPULATE
+      config.prefault ? MAP_POPULATE : 0;
+#else
+      0;
+#endif
+
+    void* mem = MAP_FAILED;
+    bool is_huge = false;
+#ifdef MAP_HUGETLB
+    if (use_huge) {
+      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | populate, -1, 0);
+      is_huge = mem != MAP_FAILED;
+    }
+#endif
+    if (mem == MAP_FAILED) {
+      mem = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mem == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+      if (use_huge) is_huge = madvise(mem, bytes, MADV_HUGEPAGE) == 0;
+#endif
+      // Pages are faulted in after the advice, such that they are faulted in as huge pages
+      if (config.prefault) {
+        for (ui64 off = 0; off < bytes; off += SMALL_PAGE_BYTES) static_cast<volatile char*>(mem)[off] = 0;
+      }
+    }
+    const bool is_locked = config.lock && mlock(mem, bytes) == 0;
+
+    Point<D>* next = static_cast<Point<D>*>(mem);
+    if (count) std::memcpy(next, buffer, count * sizeof(Point<D>));
+    const ui64 n_points = count;
+    this->release();
+
+    buffer = next;
+    count = n_points;
+    capacity_ = bytes / sizeof(Point<D>);
+    mapped = bytes;
+    huge = is_huge;
+    locked = is_locked;
+  }
+
+public:
+  // Size of the pages of the store, stores smaller than a huge page are backed by regular pages
+  static constexpr ui64 SMALL_PAGE_BYTES = 1ULL << 12,
+                        HUGE_PAGE_BYTES = 1ULL << 21;
+
+  explicit PointStore(PointStoreConfig config = PointStoreConfig()) : config(config) {}
+
+  /**
+   * @brief Copies @points into owned memory
+   */
+  explicit PointStore(std::span<const Point<D>> points, PointStoreConfig config = PointStoreConfig()) : config(config) {
+    if (points.empty()) return;
+    this->reserve(points.size());
+    std::memcpy(buffer, points.data(), points.size() * sizeof(Point<D>));
+    count = points.size();
+  }
+
+  /**
+   * @brief Borrows external memory holding the points as consecutive Point<D>::words() without copying,
+   *        that is words[i * WORDS + w] holds the bits [64w, 64(w+1)) of point i, least significant word first.
+   *        This is the reverse of the rows of the HDF5 datasets, which parse_hdf5_words converts in place.
+   *        The memory must be aligned to alignof(Point<D>) and outlive the store.
+   *        Adding points copies the store into owned memory first.
+   */
+  explicit PointStore(std::span<const ui64> words) {
+    static_assert(Point<D>::HAS_WORDS);
+    assert(words.size() % Point<D>::WORDS == 0 && (uintptr_t) words.data() % alignof(Point<D>) == 0);
+    buffer = const_cast<Point<D>*>(reinterpret_cast<const Point<D>*>(words.data()));
+    count = words.size() / Point<D>::WORDS;
+  }
+
+  PointStore(PointStore&& o) noexcept { *this = std::move(o); }
+
+  PointStore& operator=(PointStore&& o) noexcept {
+    if (this == &o) return *this;
+    this->release();
+    buffer = std::exchange(o.buffer, nullptr);
+    count = std::exchange(o.count, 0);
+    capacity_ = std::exchange(o.capacity_, 0);
+    mapped = std::exchange(o.mapped, 0);
+    huge = std::exchange(o.huge, false);
+    locked = std::exchange(o.locked, false);
+    config = o.config;
+    return *this;
+  }
+
+  PointStore(const PointStore&) = delete;
+  PointStore& operator=(const PointStore&) = delete;
+
+  ~PointStore() { this->release(); }
+
+  inline ui64 size() const noexcept { return count; }
+
+  inline const PointStoreConfig& get_config() const noexcept { return config; }
+
+  inline bool empty() const noexcept { return count == 0; }
+
+  /**
+   * @returns Number of points the store holds before it moves, 0 if the memory is borrowed
+   */
+  inline ui64 capacity() const noexcept { return capacity_; }
+
+  /**
+   * @returns True if the store borrows external memory
+   */
+  inline bool borrowed() const noexcept { return buffer && !mapped; }
+
+  /**
+   * @returns True if the store is backed by explicit or transparent huge pages
+   */
+  inline bool huge_pages() const noexcept { return huge; }
+
+  /**
+   * @returns True if the store is locked in memory, locking may fail silently under RLIMIT_MEMLOCK
+   */
+  inline bool is_locked() const noexcept { return locked; }
+
+  inline const Point<D>* data() const noexcept { return buffer; }
+  inline const Point<D>* begin() const noexcept { return buffer; }
+  inline const Point<D>* end() const noexcept { return buffer + count; }
+
+  inline const Point<D>& operator[](ui64 i) const noexcept { return buffer[i]; }
+
+  /**
+   * @brief Ensures that @n points fit in owned memory
+   */
+  void reserve(ui64 n) {
+    if (n > capacity_ || this->borrowed()) this->reallocate(std::max(n, count));
+  }
+
+  void push_back(const Point<D>& p) {
+    if (count == capacity_ || this->borrowed()) this->reallocate(std::max<ui64>(2 * count, 1));
+    buffer[count++] = p;
+  }
+
+  /**
+   * @brief Removes all points, borrowed memory is released and owned memory is kept
+   */
+  void clear() noexcept {
+    if (this->borrowed()) buffer = nullptr;
+    count = 0;
+  }
+};
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <memory_resource>
+#include "../../global.hpp"
+
+/**
+ * @brief A top-k selection structure specialised for hamming distances.
+ *        Since distances between D-dimensional points are integers in [0, D],
+ *        the k best (hamming distance, point index) pairs can be maintained without a heap:
+ *          * For k <= SMALL_K the pairs are kept in a small sorted array using branchless insertion.
+ *          * For larger k a histogram of the kept distances tracks the running kth distance,
+ *            and admitted pairs are appended to a flat list that is only sorted on extraction.
+ *
+ *        In both cases the distance of the kth point is available in O(1), and candidates
+ *        that cannot improve the result are rejected by a single comparison against threshold().
+ *        Ties at the kth distance are resolved in favour of the lowest point index on extraction.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class HammingTopK {
+public:
+  // Largest k for which the sorted array is used
+  static constexpr ui32 SMALL_K = 32;
+
+private:
+  const ui32 k;
+
+  // n : number of kept pairs, kth : largest kept distance, bound : admission threshold
+  ui32 n = 0, kth = UINT32_MAX, bound = UINT32_MAX;
+
+  /**
+   * @brief Sorted keys of the form (hamming distance << 32 | point index), used when k <= SMALL_K.
+   *        Ordering the packed keys is equivalent to ordering pairs lexicographically.
+   */
+  std::array<ui64, SMALL_K> keys;
+
+  /**
+   * @brief hist[d] : Number of kept pairs with hamming distance d, used when k > SMALL_K
+   */
+  std::pmr::vector<ui32> hist;
+
+  /**
+   * @brief All admitted pairs since the last compaction, used when k > SMALL_K.
+   *        Pairs with a distance above kth have been evicted and are filtered out on extraction.
+   */
+  std::pmr::vector<std::pair<ui32, ui32>> entries;
+
+  inline bool is_small() const noexcept { return k <= SMALL_K; }
+
+  inline void insert_small(ui32 dist, ui32 idx) noexcept {
+    const ui64 key = (((ui64) dist) << 32) | idx;
+
+    // Branchless search for the insertion position
+    ui32 pos = 0;
+    for (ui32 i = 0; i < n; ++i) {
+      pos += keys[i] < key;
+    }
+
+    // Shift larger keys one position to the right, dropping the last key if full
+    for (ui32 i = std::min(n, k - 1); i > pos; --i) {
+      keys[i] = keys[i-1];
+    }
+    keys[pos] = key;
+
+    n += n < k;
+    kth = keys[n-1] >> 32;
+  }
+
+  inline void insert_large(ui32 dist, ui32 idx) {
+    entries.emplace_back(dist, idx);
+    ++hist[dist];
+
+    if (n < k) {
+      kth = n++ ? std::max(kth, dist) : dist;
+    } else {
+      // Evict a single pair at the kth distance and find the new kth distance
+      --hist[kth];
+      while (!hist[kth]) --kth;
+    }
+
+    // Drop evicted pairs to bound memory usage
+    if (entries.size() >= (k << 3)) {
+      std::erase_if(entries, [this](const auto& e) { return e.first > kth; });
+    }
+  }
+
+public:
+  /**
+   * @param mr Memory resource used by the structures of large k
+   */
+  HammingTopK(ui32 k, std::pmr::memory_resource* mr = std::pmr::get_default_resource()) 
+    : k(k), keys(), hist(mr), entries(mr)
+  {
+    assert(k > 0);
+    if (!is_small()) {
+      hist.resize(D + 1, 0);
+      entries.reserve(k << 1);
+    }
+  }
+
+  /**
+   * @returns Number of pairs currently kept, at most k
+   */
+  inline ui32 size() const noexcept { return n; }
+
+  inline bool empty() const noexcept { return n == 0; }
+
+  /**
+   * @returns The hamming distance of the kth point, or the largest distance kept if less
+   *          than k points have been admitted, and UINT32_MAX if none has been admitted.
+   */
+  inline ui32 get_kth_dist() const noexcept { return n ? kth : UINT32_MAX; }
+
+  /**
+   * @returns Candidates with a hamming distance of at least the threshold can never be admitted
+   */
+  inline ui32 threshold() const noexcept { return bound; }
+
+  /**
+   * @brief Attempt to admit the point with index @idx at hamming distance @dist
+   * @returns True if the point is among the k nearest points admitted so far
+   */
+  inline bool insert(ui32 dist, ui32 idx) noexcept {
+    if (dist >= bound) return false;
+
+    if (is_small()) insert_small(dist, idx);
+    else            insert_large(dist, idx);
+
+    if (n == k) bound = kth;
+    return true;
+  }
+
+  /**
+   * @brief Extract the indices of the kept points in ascending order by hamming distance.
+   *        The structure remains valid, such that points can still be inserted afterwards.
+   */
+  std::vector<ui32> extract() {
+    std::vector<ui32> ret;
+    this->extract(ret);
+    return ret;
+  }
+
+  /**
+   * @brief Extract the indices of the kept points into @ret, replacing its contents
+   */
+  void extract(std::vector<ui32>& ret) {
+    this->extract(ret, nullptr);
+  }
+
+  /**
+   * @brief Extract the indices of the kept points into @ret and, if given, 
+   *        their hamming distances into @dists, replacing their contents
+   */
+  void extract(std::vector<ui32>& ret, std::vector<ui32>* dists) {
+    ret.resize(n);
+    if (dists) dists->resize(n);
+
+    if (is_small()) {
+      for (ui32 i = 0; i < n; ++i) {
+        ret[i] = (ui32) keys[i];
+        if (dists) (*dists)[i] = keys[i] >> 32;
+      }
+      return;
+    }
+
+    std::erase_if(entries, [this](const auto& e) { return e.first > kth; });
+    std::sort(ALL(entries));
+    for (ui32 i = 0; i < n; ++i) {
+      ret[i] = entries[i].second;
+      if (dists) (*dists)[i] = entries[i].first;
+    }
+  }
+};
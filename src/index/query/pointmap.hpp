@@ -1,18 +1,24 @@
 #include "../point.hpp"
+#include "../pivottable.hpp"
+#include "../shortsketches.hpp"
+#include <cmath>
+#include <memory_resource>
 #include <unordered_set>
 #include "../../global.hpp"
+#include "hammingtopk.hpp"
 /**
  * @brief An utility class for storing points in a map-like structure 
  *        that allows for fast retrieval of the knn points within the minimum hamming distance 
  *        to a query point.
  *        
  *        The primary motivation behind this class is to avoid sorting points by their hamming distance
- *        and to instead maintain a queue of the k-nearest-neighbours to the query point among all points
- *        inserted into this map.
+ *        and to instead maintain the k-nearest-neighbours to the query point among all points
+ *        inserted into this map in a HammingTopK.
  *        
  *        This allows for asymptotic bounds of 
  *          * KNN Extraction in O(log(k)*k)
- *          * Insertion in O(log(k) + D) if the point is not already in the map, O(1) otherwise.
+ *          * Insertion in O(1) if the point is already in the map or rejected by a pre-filter, otherwise 
+ *            in O(D) for a distance computation that is abandoned once it reaches threshold()
  *          * Distance of the kth point from the query point in O(1)
  * @tparam D 
  */
@@ -20,32 +26,68 @@ template <ui32 D>
 class PointMap
 {
   /**
-   * @brief A queue of the k-nearest-neighbours to the query point 
-   *        among all points inserted into this map.
+   * @brief The k-nearest-neighbours to the query point among all points inserted into this map.
    *        The elements are kept as pairs of the form (hamming distance, point index)
    */
-  max_queue<std::pair<ui32, ui32>> knn;     
+  HammingTopK<D> knn;
 
   /**
    * @brief Contains all points we have computed hamming distances for so far 
    */
-  std::unordered_set<ui32> seen;       
+  std::pmr::unordered_set<ui32> seen;
 
-  const std::vector<Point<D>> &points; // reference to points for look up of point by idx
+  std::span<const Point<D>> points; // view of the points for look up of point by idx
   const ui32 k; // k : number of nearest points to query after
   const Point<D>& query;
 
+  // Optional short sketches of points, which reject candidates before their full distance is computed
+  const ShortSketches<D>* shorts = nullptr;
+  typename ShortSketches<D>::Sketch query_short;
+  float short_factor = 1.0f; // candidates with short distance * short_factor >= threshold are rejected
+
+  // Optional distances of the points to pivots, which reject candidates by the triangle inequality
+  const PivotTable<D>* pivots = nullptr;
+  typename PivotTable<D>::Row query_pivots;
+
 public:
   /** 
    * @brief Construct a new Point Map object
-   * @arg points A pointer to the vector of points to use as the source-order for the indices inserted into this map
+   * @arg points The points to use as the source-order for the indices inserted into this map
+   * @arg mr Memory resource used by the map, such as the arena of a QueryContext
    */
-  PointMap(std::vector<Point<D>>& points, const Point<D>& query, ui32 k = 10) 
-    : knn(), seen(), points(points), query(query), k(k) 
+  PointMap(std::span<const Point<D>> points, const Point<D>& query, ui32 k = 10, 
+           std::pmr::memory_resource* mr = std::pmr::get_default_resource()) 
+    : knn(k, mr), seen(mr), points(points), query(query), k(k) 
   {
     assert(k > 0 && k <= points.size());
   };
 
+  /**
+   * @brief Pre-filters the candidates inserted by index with their short sketches in @shorts. A candidate whose 
+   *        short distance, a lower bound on its distance, reaches the kth distance is rejected exactly. 
+   *        With a finite @slack the short distance is also scaled to an estimate of the full distance, 
+   *        and candidates estimated at more than (1 + @slack) times the kth distance are rejected, 
+   *        which may lose true neighbours.
+   * @param shorts The short sketches of the points of the map, must outlive the map
+   */
+  void set_prefilter(const ShortSketches<D>* shorts, float slack = INFINITY) noexcept {
+    this->shorts = shorts && shorts->bits() ? shorts : nullptr;
+    if (!this->shorts) return;
+    query_short = shorts->project(query);
+    short_factor = std::max(1.0f, (float) D / (shorts->bits() * (1.0f + slack)));
+  }
+
+  /**
+   * @brief Pre-filters the candidates inserted by index with their distances to the pivots in @pivots,
+   *        rejecting a candidate p once |d(query, pivot) - d(p, pivot)| reaches the kth distance for any pivot. 
+   *        The filter is exact, and the distances of the query to the pivots are computed once here.
+   * @param pivots The pivot table of the points of the map, must outlive the map
+   */
+  void set_pivots(const PivotTable<D>* pivots) noexcept {
+    this->pivots = pivots && pivots->count() ? pivots : nullptr;
+    if (this->pivots) query_pivots = pivots->project(query);
+  }
+
   /**
    * @brief Returns the number of points inserted into this map, 
    *        note that this is not the same as the number of initially given points
@@ -59,7 +101,19 @@ public:
    * @return ui32 The hamming distance of the kth point from the query point
    */
   inline ui32 get_kth_dist() const noexcept {
-    return knn.empty() ? UINT32_MAX : knn.top().first;
+    return knn.get_kth_dist();
+  }
+
+  /**
+   * @returns Number of points among the k nearest points found so far, at most k
+   */
+  inline ui32 kept() const noexcept { return knn.size(); }
+
+  /**
+   * @returns Points at a hamming distance of at least the threshold can no longer enter the k nearest points
+   */
+  inline ui32 threshold() const noexcept {
+    return knn.threshold();
   }
 
   /**
@@ -70,11 +124,32 @@ public:
    *         returned in ascending order by hamming distance to query point
    */
   std::vector<ui32> extract_k_nearest() noexcept {
-    std::vector<ui32> ret(knn.size(), UINT32_MAX);
-    for (int i = knn.size(); !knn.empty(); knn.pop()) {
-      ret[--i] = knn.top().second;
-    }
-    return ret;
+    return knn.extract();
+  }
+
+  /**
+   * @brief Extracts the k points with the lowest hamming distance to the query target into @out,
+   *        reusing its capacity. 
+   */
+  void extract_k_nearest(std::vector<ui32>& out) noexcept {
+    knn.extract(out);
+  }
+
+  /**
+   * @brief Extracts the k points with the lowest hamming distance to the query target into @out,
+   *        and their hamming distances to the query target into @dists. 
+   */
+  void extract_k_nearest(std::vector<ui32>& out, std::vector<ui32>& dists) noexcept {
+    knn.extract(out, &dists);
+  }
+
+  /**
+   * @brief Returns the up to k points with the lowest hamming distance to the query target found so far,
+   *        in ascending order by hamming distance, such as the progressive results of a query under a budget. 
+   *        Unlike extract_k_nearest the map stays valid and insertion may continue.
+   */
+  std::vector<ui32> k_nearest() noexcept {
+    return knn.extract();
   }
   
   /**
@@ -84,27 +159,59 @@ public:
   inline bool contains(const ui32& idx) const noexcept { return seen.find(idx) != seen.end(); }
   
   /**
-   * @brief Inserts the point with the given idx into this map in asymptotic O(log(k) + D) time 
-   *        (upper bound is distance computation of point, which is only executed in case no entry exist).
+   * @brief Inserts the point with the given idx into this map. A point seen before is skipped, and a new point 
+   *        is first checked against the short sketch and pivot pre-filters, which reject it without reading it. 
+   *        Otherwise its distance is computed until it reaches threshold(), in at most O(D) time.
+   *        Rejected and abandoned points count as seen, and are not checked again.
    * @param idx index of the point to insert
+   * @returns True if the point is among the k nearest points inserted so far
    */
-  void insert(const ui32& idx) noexcept {
-    if (this->contains(idx)) return;
+  bool insert(const ui32& idx) noexcept {
+    if (this->contains(idx)) return false;
     seen.emplace(idx);
 
-    ui32 hdist = query.distance(points[idx]);
-    if (knn.size() < k) {
-      knn.emplace(hdist, idx);
-    } else if (hdist < knn.top().first) {
-      knn.pop();
-      knn.emplace(hdist, idx);
-    }
+    if (shorts && shorts->distance(query_short, idx) * short_factor >= knn.threshold()) return false;
+    if (pivots && pivots->lower_bound(query_pivots, idx) >= knn.threshold()) return false;
+    return knn.insert(query.distance_bounded(points[idx], knn.threshold()), idx);
   }
   
+  /**
+   * @brief Inserts the point with the given idx, whose value @point is already at hand, such that 
+   *        the point is not fetched from the points of the map. The exact pre-filters are skipped, since they 
+   *        only reject points that the bounded distance rejects as well. A lossy short sketch prefilter is applied, 
+   *        such that both overloads admit the same points.
+   * @returns True if the point is among the k nearest points inserted so far
+   */
+  bool insert(const ui32& idx, const Point<D>& point) noexcept {
+    if (this->contains(idx)) return false;
+    seen.emplace(idx);
+
+    if (shorts && short_factor > 1.0f && shorts->distance(query_short, idx) * short_factor >= knn.threshold()) return false;
+    return knn.insert(query.distance_bounded(point, knn.threshold()), idx);
+  }
+
+  /**
+   * @brief Inserts the points with the indices in @ids, where @sketches[i] is the point with index @ids[i]
+   * @returns The number of inserted points that are among the k nearest points inserted so far
+   */
+  ui32 insert(std::span<const ui32> ids, std::span<const Point<D>> sketches) noexcept {
+    assert(ids.size() == sketches.size());
+    ui32 admitted = 0;
+    for (ui32 i = 0; i < ids.size(); ++i) {
+      admitted += this->insert(ids[i], sketches[i]);
+    }
+    return admitted;
+  }
+
+  /**
+   * @returns The number of inserted points that are among the k nearest points inserted so far
+   */
   template<iterator_to<ui32> IdxIterator>
-  void insert(IdxIterator beg, IdxIterator end) noexcept {
+  ui32 insert(IdxIterator beg, IdxIterator end) noexcept {
+    ui32 admitted = 0;
     for (auto it = beg; it != end; ++it) {
-      this->insert(*it);
+      admitted += this->insert(*it);
     }
+    return admitted;
   }
 };
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "../../global.hpp"
+#include "../lshmap.hpp"
+#include "probesequence.hpp"
+
+/**
+ * @brief The position of a query in the probe sequence of a single map.
+ *        If the margins of the hash functions of the map are known, the cursor is query-directed and visits 
+ *        the buckets in ascending order by the flip scores of the bits they perturb, see ProbeSequence.
+ *        Otherwise it visits the buckets in ascending order by hamming distance to the bucket of the query.
+ *        Every bucket is split into slices that are scanned one at a time.
+ *        It also records how many of the scanned points entered the k nearest points of the query,
+ *        which is used to estimate the yield of the next slice.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+struct ProbeCursor {
+  const LSHMap<D>* map = nullptr;
+  hash_idx hash = 0;        // the bucket of the query in map
+  ui32 hdist = 0,           // hamming distance of the current bucket to hash
+       mask_index = 0,      // index of the current bucket among the buckets at hdist, or in the probe sequence if directed
+       offset = 0,          // index of the first point in the current bucket that has not been scanned
+       probes = 0,          // number of buckets completed
+       scanned = 0,         // number of points scanned
+       admitted = 0;        // number of scanned points that entered the k nearest points of the query
+  const Point<D>* query = nullptr;
+  bucket_view bucket;       // the current bucket
+  ui32 bound = 0;           // lower bound on the distance of query to the points of bucket, 0 if unknown
+  std::span<const Point<D>> sketches; // inlined copies of the points of bucket, empty if the bucket is not inlined
+  bool directed = false;    // true if the buckets are visited in the order of sequence
+  ProbeSequence sequence;
+  std::vector<float> flips; // flips[i] : flip score of the i'th bit of hash, if directed
+
+  /**
+   * @returns The hash of @query in @map. If the hashes of the map have margins, the flip scores of its bits
+   *          are computed in the same pass and kept in flips, such that start need not evaluate the hashes again.
+   */
+  hash_idx locate(const LSHMap<D>* map, const Point<D>& query) {
+    if (!map->hashes.has_margins()) return map->hash(query);
+    return map->hashes.hash_with_margins(query, flips);
+  }
+
+  /**
+   * @brief Places the cursor at the bucket of @query in @map
+   * @param hash The hash of @query in @map
+   * @param scored True if flips holds the flip scores of @query in @map, as computed by locate
+   */
+  void start(const LSHMap<D>* map, const Point<D>& query, hash_idx hash, bool scored = false) {
+    this->map = map;
+    this->query = &query;
+    this->hash = hash;
+    hdist = mask_index = offset = probes = scanned = admitted = 0;
+
+    directed = map->hashes.has_margins();
+    if (directed) {
+      if (!scored) map->hashes.hash_with_margins(query, flips);
+      sequence.reset(flips, std::min(ProbeSequence::DEFAULT_MAX_FLIPS, map->depth() - 1));
+      this->next_directed();
+    } else {
+      this->visit(map->next_bucket(hash, 0, 0));
+    }
+  }
+
+  /**
+   * @returns True if every bucket in the probe sequence has been scanned
+   */
+  inline bool exhausted() const noexcept { return hdist >= map->depth(); }
+
+  /**
+   * @returns Number of points in the current bucket that have not been scanned
+   */
+  inline ui32 remaining() const noexcept { return bucket.size() - offset; }
+
+  /**
+   * @brief Marks the next @n points of the current bucket as scanned, of which @n_admitted entered the k nearest.
+   *        Moves on to the next bucket once the current bucket has been scanned.
+   * @returns True if the current bucket was completed
+   */
+  bool consume(ui32 n, ui32 n_admitted) {
+    offset += n;
+    scanned += n;
+    admitted += n_admitted;
+    if (offset < bucket.size()) return false;
+
+    this->next_bucket();
+    return true;
+  }
+
+  /**
+   * @brief Moves the cursor to the next bucket in the probe sequence, skipping the rest of the current bucket
+   */
+  void next_bucket() {
+    ++probes;
+    offset = 0;
+    if (directed) {
+      ++mask_index;
+      this->next_directed();
+      return;
+    }
+
+    if (!map->has_next_bucket(hash, hdist, ++mask_index)) {
+      ++hdist;
+      mask_index = 0;
+    }
+    if (this->exhausted()) this->leave();
+    else                   this->visit(map->next_bucket(hash, hdist, mask_index));
+  }
+
+private:
+  /**
+   * @brief Moves a directed cursor to the bucket of the next perturbation in the sequence
+   */
+  void next_directed() {
+    ui64 mask;
+    if (!sequence.next(mask, hdist)) {
+      hdist = map->depth();
+      this->leave();
+      return;
+    }
+    this->visit(hash ^ (hash_idx) mask);
+  }
+
+  inline void visit(hash_idx bidx) {
+    bucket = (*map)[bidx];
+    sketches = map->inlined(bidx);
+    const BucketSummary<D>* summary = map->summary(bidx);
+    bound = summary ? summary->lower_bound(*query) : 0;
+  }
+
+  inline void leave() noexcept {
+    bucket = bucket_view();
+    sketches = {};
+    bound = 0;
+  }
+};
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <bit>
+#include <span>
+
+#include "../../global.hpp"
+
+/**
+ * @brief Generates the perturbation masks of a query in ascending order by score, in the style of the
+ *        query-directed multi-probe LSH of Lv et al. Every bit of the hash of the query has a flip score,
+ *        where a lower score means the bit is more likely to differ for a near neighbour, and the score
+ *        of a perturbation set is the sum of the scores of its bits.
+ *
+ *        The bits are sorted by score, and sets of positions in the sorted order are generated from a heap
+ *        starting at { 0 }. Popping the set A with the largest position j pushes shift(A) = A - { j } + { j+1 }
+ *        and expand(A) = A + { j+1 }, which generates every set exactly once in ascending order by score.
+ */
+class ProbeSequence {
+  struct Candidate {
+    float score;
+    ui64 positions; // the set of positions in sorted
+    ui32 last;      // the largest position in the set
+    ui32 size;      // number of positions in the set
+
+    inline bool operator>(const Candidate& o) const noexcept { return score > o.score; }
+  };
+
+  std::vector<std::pair<float, ui32>> sorted; // (flip score, bit) in ascending order by score
+  std::vector<Candidate> heap;                // min-heap of candidate sets by score
+  ui32 max_flips = 0;
+  bool started = false;
+
+  inline void push(Candidate c) {
+    heap.push_back(c);
+    std::push_heap(ALL(heap), std::greater<Candidate>());
+  }
+
+public:
+  // Default maximum number of flipped bits, matching the default depth of BucketMask
+  static constexpr ui32 DEFAULT_MAX_FLIPS = 4;
+
+  /**
+   * @brief Restarts the sequence for a query
+   * @param scores scores[i] : the flip score of the i'th bit of the hash of the query
+   * @param max_flips The maximum number of bits flipped by a perturbation
+   */
+  void reset(std::span<const float> scores, ui32 max_flips = DEFAULT_MAX_FLIPS) {
+    assert(scores.size() <= 64);
+    sorted.clear();
+    for (ui32 i = 0; i < scores.size(); ++i) {
+      sorted.emplace_back(scores[i], i);
+    }
+    std::sort(ALL(sorted));
+
+    heap.clear();
+    this->max_flips = max_flips;
+    started = false;
+  }
+
+  /**
+   * @brief Writes the next perturbation mask of the sequence to @mask, starting with the empty mask
+   * @param flips Set to the number of bits flipped by @mask
+   * @returns False if the sequence is exhausted
+   */
+  bool next(ui64& mask, ui32& flips) {
+    if (!started) {
+      started = true;
+      if (!sorted.empty() && max_flips > 0) push({ sorted[0].first, 1ULL, 0, 1 });
+      mask = 0;
+      flips = 0;
+      return true;
+    }
+    if (heap.empty()) return false;
+
+    std::pop_heap(ALL(heap), std::greater<Candidate>());
+    const Candidate c = heap.back();
+    heap.pop_back();
+
+    const ui32 j = c.last + 1;
+    if (j < sorted.size()) {
+      const float s_last = sorted[c.last].first, s_next = sorted[j].first;
+      push({ c.score - s_last + s_next, (c.positions & ~(1ULL << c.last)) | (1ULL << j), j, c.size });  // shift
+      if (c.size < max_flips) {
+        push({ c.score + s_next, c.positions | (1ULL << j), j, c.size + 1 });                       // expand
+      }
+    }
+
+    mask = 0;
+    for (ui64 positions = c.positions; positions; positions &= positions - 1) {
+      mask |= 1ULL << sorted[std::countr_zero(positions)].second;
+    }
+    flips = c.size;
+    return true;
+  }
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <list>
+#include <optional>
+
+#include "../../global.hpp"
+#include "../lshmap.hpp"
+
+/**
+ * @brief Configuration of a QueryCache
+ */
+struct QueryCacheConfig {
+  ui32 capacity = 1 << 16;       // Maximum number of cached results
+  ui64 max_bytes = 64ULL << 20;  // Maximum number of bytes used by the cached results
+  ui32 near_distance = 0;        // Queries within this hamming distance of a cached query reuse its result, 0 disables near-duplicate lookups
+  ui32 shards = 16;              // Number of independently locked partitions of the cache
+};
+
+/**
+ * @brief Counters reported by a QueryCache
+ */
+struct QueryCacheStats {
+  ui64 hits = 0,      // Lookups answered by a cached result of the same query
+       near_hits = 0, // Lookups answered by a cached result of a near-duplicate query
+       misses = 0,    // Lookups not answered by the cache
+       entries = 0,   // Number of cached results
+       bytes = 0;     // Approximate number of bytes used by the cached results
+
+  inline double hit_rate() const noexcept {
+    const ui64 lookups = hits + near_hits + misses;
+    return lookups ? (hits + near_hits) / (double) lookups : 0.0;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const QueryCacheStats& stats) {
+    os << "QueryCacheStats: " << std::endl
+       << "\tHits: " << stats.hits << std::endl
+       << "\tNear-duplicate hits: " << stats.near_hits << std::endl
+       << "\tMisses: " << stats.misses << std::endl
+       << "\tHit rate: " << stats.hit_rate() << std::endl
+       << "\tEntries: " << stats.entries << std::endl
+       << "\tBytes: " << stats.bytes << std::endl;
+    return os;
+  }
+};
+
+/**
+ * @brief A concurrent LRU cache of query results.
+ *        Results are looked up by the query sketch, and if near-duplicate lookups are enabled,
+ *        by the bucket key of the query in the first map of the index. Every cached query in the
+ *        same bucket within near_distance of the query is a candidate, and the closest one is reused.
+ *        The cache is partitioned by bucket key, such that both lookups of a query lock a single shard.
+ *        Results cached before the last call to invalidate are never returned. Results are tagged with 
+ *        the path of the index that produced them, and only answer lookups of the same path.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class QueryCache {
+  struct Entry {
+    Point<D> query;
+    hash_idx key;   // bucket key of query in the first map of the index
+    ui32 k;
+    float recall;
+    ui32 path;      // tag of the path of the index that produced result
+    ui64 generation;
+    std::vector<ui32> result;
+  };
+
+  using Iterator = typename std::list<Entry>::iterator;
+
+  struct Shard {
+    std::mutex mtx;
+    std::list<Entry> lru;                           // cached entries, most recently used first
+    hmap<ui64, Iterator> exact;                     // sketch key -> entry
+    hmap<hash_idx, std::vector<Iterator>> buckets;  // bucket key -> entries, if near-duplicate lookups are enabled
+    ui64 bytes = 0;
+  };
+
+  // Approximate memory overhead of an entry besides its result, including the list node and index entries
+  static constexpr ui64 ENTRY_OVERHEAD = sizeof(Entry) + 8 * sizeof(void*);
+
+  const QueryCacheConfig config;
+  const ui32 shard_capacity;
+  const ui64 shard_bytes;
+  std::vector<Shard> shards;
+
+  std::atomic<ui64> generation, hits, near_hits, misses;
+
+  inline Shard& shard_of(hash_idx key) noexcept { return shards[key % shards.size()]; }
+
+  static inline ui64 exact_key(const Point<D>& query, ui32 k, float recall, ui32 path) noexcept {
+    ui64 h = std::hash<std::bitset<D>>{}(query);
+    h ^= (((ui64) k) << 32 | std::bit_cast<ui32>(recall)) + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    h ^= path + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+  }
+
+  static inline ui64 entry_bytes(const Entry& e) noexcept {
+    return ENTRY_OVERHEAD + e.result.size() * sizeof(ui32);
+  }
+
+  void erase(Shard& s, Iterator it) {
+    auto ex = s.exact.find(exact_key(it->query, it->k, it->recall, it->path));
+    if (ex != s.exact.end() && ex->second == it) s.exact.erase(ex);
+
+    if (config.near_distance) {
+      auto bk = s.buckets.find(it->key);
+      std::erase(bk->second, it);
+      if (bk->second.empty()) s.buckets.erase(bk);
+    }
+
+    s.bytes -= entry_bytes(*it);
+    s.lru.erase(it);
+  }
+
+  inline bool matches(const Entry& e, ui32 k, float recall, ui32 path) const noexcept {
+    return e.k == k && e.recall == recall && e.path == path;
+  }
+
+public:
+  QueryCache(QueryCacheConfig config = QueryCacheConfig())
+    : config(config),
+      shard_capacity(std::max(1U, (config.capacity + config.shards - 1) / std::max(1U, config.shards))),
+      shard_bytes(config.max_bytes / std::max(1U, config.shards)),
+      shards(std::max(1U, config.shards)),
+      generation(0), hits(0), near_hits(0), misses(0)
+  {}
+
+  const QueryCacheConfig& get_config() const noexcept { return config; }
+
+  /**
+   * @brief Looks up the result of the query @query for @k nearest neighbours at @recall
+   * @param key The bucket key of @query in the first map of the index
+   * @param path Tag of the path of the index asking, only results cached by the same path are returned
+   * @returns The cached result, or std::nullopt on a miss
+   */
+  std::optional<std::vector<ui32>> lookup(const Point<D>& query, hash_idx key, ui32 k, float recall, ui32 path = 0) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::mutex> lock(s.mtx);
+    const ui64 gen = generation.load();
+
+    auto ex = s.exact.find(exact_key(query, k, recall, path));
+    if (ex != s.exact.end()) {
+      Iterator it = ex->second;
+      if (it->generation != gen) {
+        this->erase(s, it);
+      } else if (it->query == query && matches(*it, k, recall, path)) {
+        s.lru.splice(s.lru.begin(), s.lru, it);
+        ++hits;
+        return it->result;
+      }
+    }
+
+    if (config.near_distance) {
+      auto bk = s.buckets.find(key);
+      if (bk != s.buckets.end()) {
+        Iterator best = s.lru.end();
+        ui32 best_dist = config.near_distance + 1;
+        for (auto& it : bk->second) {
+          if (it->generation != gen || !matches(*it, k, recall, path)) continue;
+          const ui32 dist = query.distance(it->query);
+          if (dist < best_dist) {
+            best = it;
+            best_dist = dist;
+          }
+        }
+
+        if (best != s.lru.end()) {
+          s.lru.splice(s.lru.begin(), s.lru, best);
+          ++near_hits;
+          return best->result;
+        }
+      }
+    }
+
+    ++misses;
+    return std::nullopt;
+  }
+
+  /**
+   * @brief Caches @result as the result of the query @query for @k nearest neighbours at @recall,
+   *        evicting the least recently used results while the cache exceeds its capacity or memory limit.
+   * @param key The bucket key of @query in the first map of the index
+   * @param path Tag of the path of the index that produced @result
+   */
+  void insert(const Point<D>& query, hash_idx key, ui32 k, float recall, std::vector<ui32> result, ui32 path = 0) {
+    Shard& s = shard_of(key);
+    std::unique_lock<std::mutex> lock(s.mtx);
+
+    const ui64 ek = exact_key(query, k, recall, path);
+    auto ex = s.exact.find(ek);
+    if (ex != s.exact.end()) this->erase(s, ex->second);
+
+    s.lru.push_front(Entry{ query, key, k, recall, path, generation.load(), std::move(result) });
+    s.exact[ek] = s.lru.begin();
+    if (config.near_distance) s.buckets[key].push_back(s.lru.begin());
+    s.bytes += entry_bytes(s.lru.front());
+
+    while (s.lru.size() > 1 && (s.lru.size() > shard_capacity || s.bytes > shard_bytes)) {
+      this->erase(s, std::prev(s.lru.end()));
+    }
+  }
+
+  /**
+   * @brief Invalidates all cached results, such that they are never returned by lookup.
+   *        Invalidated results are evicted lazily, which makes this O(1).
+   */
+  inline void invalidate() noexcept { ++generation; }
+
+  /**
+   * @brief Removes all cached results and resets the counters
+   */
+  void clear() {
+    for (auto& s : shards) {
+      std::unique_lock<std::mutex> lock(s.mtx);
+      s.lru.clear();
+      s.exact.clear();
+      s.buckets.clear();
+      s.bytes = 0;
+    }
+    hits = near_hits = misses = 0;
+  }
+
+  QueryCacheStats stats() {
+    QueryCacheStats ret;
+    ret.hits = hits.load();
+    ret.near_hits = near_hits.load();
+    ret.misses = misses.load();
+    for (auto& s : shards) {
+      std::unique_lock<std::mutex> lock(s.mtx);
+      ret.entries += s.lru.size();
+      ret.bytes += s.bytes;
+    }
+    return ret;
+  }
+};
@@ -0,0 +1,119 @@
+#pragma once
+
+#include <memory_resource>
+#include <optional>
+
+#include "../../global.hpp"
+#include "../../util/ringbuffer.hpp"
+#include "../lshmap.hpp"
+#include "probecursor.hpp"
+
+/**
+ * @brief Scratch memory of a query, reused between the queries of a single thread.
+ *        Temporary structures of a query, such as its PointMap, are allocated from a monotonic arena
+ *        that is released in bulk by reset. If a query overflows the arena, the arena grows to fit it
+ *        on the next reset, such that the queries of a warmed-up context do not touch the heap.
+ *        A context may only be used by one query at a time.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class QueryContext {
+  /**
+   * @brief Upstream of the arena, records the number of bytes requested beyond the arena buffer
+   */
+  class OverflowResource : public std::pmr::memory_resource {
+  public:
+    ui64 requested = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t align) override {
+      requested += bytes;
+      return std::pmr::new_delete_resource()->allocate(bytes, align);
+    }
+
+    void do_deallocate(void* p, size_t bytes, size_t align) override {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, align);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+  };
+
+  std::vector<std::byte> buffer;
+  OverflowResource overflow;
+  std::optional<std::pmr::monotonic_buffer_resource> arena;
+
+  // True while a query uses the context
+  bool active = false;
+
+public:
+  // Initial size of the arena of a context
+  static constexpr ui64 DEFAULT_ARENA_BYTES = 1 << 16;
+
+  std::vector<hash_idx> hash;                    // hash[m] : the hash of the query in map[m]
+  std::vector<bucket_view> bucket;               // bucket[m] : view of the bucket currently probed in map[m]
+  std::vector<std::span<const Point<D>>> sketches; // sketches[m] : inlined copies of the points of bucket[m], if any
+  RingBuffer<std::pair<ui32, ui32>> slices;      // (map, offset) of the bucket slices waiting to be scanned
+  std::vector<ProbeCursor<D>> cursors;           // cursors[m] : position of the query in the probe sequence of map[m]
+  std::vector<std::pair<float, ui32>> probes;    // heap of (estimated yield, map) of the next slice of every map
+  std::vector<ui32> result;                      // indices of the k nearest neighbours of the last query
+  std::vector<ui32> dists;                       // dists[i] : hamming distance of result[i] to the last query
+
+  explicit QueryContext(ui64 arena_bytes = DEFAULT_ARENA_BYTES) : buffer(arena_bytes) {
+    arena.emplace(buffer.data(), buffer.size(), &overflow);
+  }
+
+  QueryContext(const QueryContext&) = delete;
+  QueryContext& operator=(const QueryContext&) = delete;
+
+  /**
+   * @returns The arena to allocate the temporary structures of the current query from
+   */
+  inline std::pmr::memory_resource* resource() noexcept { return &*arena; }
+
+  /**
+   * @brief Releases all memory allocated from the arena, growing the arena if the last query overflowed it.
+   *        Must not be called while structures allocated from the arena are alive.
+   * @param M Number of maps queried by the next query
+   */
+  void reset(ui32 M) {
+    arena.reset();
+    if (overflow.requested) {
+      buffer = std::vector<std::byte>(buffer.size() + overflow.requested);
+      overflow.requested = 0;
+    }
+    arena.emplace(buffer.data(), buffer.size(), &overflow);
+
+    hash.resize(M);
+    bucket.resize(M);
+    sketches.resize(M);
+    slices.reset(M);
+    cursors.resize(M);
+    probes.clear();
+  }
+
+  /**
+   * @returns Number of bytes in the arena buffer
+   */
+  inline ui64 arena_size() const noexcept { return buffer.size(); }
+
+  /**
+   * @brief Calls @fn with the context of the calling thread, or with a temporary context
+   *        if the context of the thread is already in use by a query on the call stack.
+   * @returns The value returned by @fn
+   */
+  template<typename Fn>
+  static auto with_local(Fn fn) {
+    static thread_local QueryContext<D> local;
+    if (local.active) {
+      QueryContext<D> nested;
+      return fn(nested);
+    }
+
+    struct Guard {
+      bool& active;
+      Guard(bool& active) : active(active) { active = true; }
+      ~Guard() { active = false; }
+    } guard(local.active);
+    return fn(local);
+  }
+};
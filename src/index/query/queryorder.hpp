@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../../global.hpp"
+#include "../lshmap.hpp"
+
+/**
+ * @brief The order in which a batch of queries is answered
+ */
+enum class QueryOrder {
+  Input,   // The order of the batch
+  MapKey,  // Ascending by the keys of the queries in the first maps, such that queries sharing buckets are adjacent
+  ZOrder,  // Ascending by the interleaved low 32 bits of the keys in the first two maps
+  Gray,    // Ascending by the Gray code rank of the key in the first map, such that adjacent keys mostly differ by a single bit
+};
+
+namespace QueryOrdering {
+  // Number of maps whose keys are used to order the queries
+  constexpr ui32 ORDER_MAPS = 2;
+
+  /**
+   * @returns @a and @b with their bits interleaved, bit i of @a is placed at bit 2i
+   */
+  inline ui64 interleave(ui32 a, ui32 b) noexcept {
+    auto spread = [](ui64 x) {
+      x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+      x = (x | (x << 8))  & 0x00FF00FF00FF00FFULL;
+      x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0FULL;
+      x = (x | (x << 2))  & 0x3333333333333333ULL;
+      x = (x | (x << 1))  & 0x5555555555555555ULL;
+      return x;
+    };
+    return spread(a) | (spread(b) << 1);
+  }
+
+  /**
+   * @returns The position of @g in the reflected binary Gray code sequence
+   */
+  inline ui64 gray_rank(ui64 g) noexcept {
+    for (ui32 shift = 1; shift < 64; shift <<= 1) {
+      g ^= g >> shift;
+    }
+    return g;
+  }
+
+  /**
+   * @brief Returns a permutation of the indices of @queries in the order they should be answered.
+   *        Ties are kept in input order.
+   * @param queries A random access range of points, such as a vector or a PointStore
+   * @param maps The maps of the index, the keys of the queries in the first maps are used for ordering
+   */
+  template<ui32 D, typename Points>
+  std::vector<ui32> permutation(const Points& queries, const std::vector<LSHMap<D>*>& maps, QueryOrder order) {
+    std::vector<ui32> perm(queries.size());
+    std::iota(ALL(perm), 0);
+    if (order == QueryOrder::Input || maps.empty()) return perm;
+
+    const ui32 M = std::min(ORDER_MAPS, (ui32) maps.size());
+    std::vector<std::tuple<ui64, ui64, ui32>> keys(queries.size()); // (sort key, secondary sort key, query index)
+    for (ui32 q = 0; q < queries.size(); ++q) {
+      const ui64 k0 = maps[0]->hash(queries[q]),
+                 k1 = M > 1 ? maps[1]->hash(queries[q]) : 0;
+
+      switch (order) {
+        case QueryOrder::MapKey: keys[q] = { k0, k1, q }; break;
+        case QueryOrder::ZOrder: keys[q] = { interleave(k0, k1), 0, q }; break;
+        case QueryOrder::Gray:   keys[q] = { gray_rank(k0), 0, q }; break;
+        default:                 keys[q] = { 0, 0, q }; break;
+      }
+    }
+
+    std::sort(ALL(keys));
+    std::transform(ALL(keys), perm.begin(), [](const auto& e) { return std::get<2>(e); });
+    return perm;
+  }
+}
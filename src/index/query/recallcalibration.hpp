@@ -0,0 +1,104 @@
+#pragma once
+
+#include "../../global.hpp"
+#include "../../util/ranges.hpp"
+
+/**
+ * @brief A table mapping requested recall to the number of candidate points a query should
+ *        compute distances to before stopping. The table is fitted from queries with known
+ *        ground truth, which replaces the fixed constants of the failure-probability heuristics
+ *        with budgets measured on the indexed dataset. Budgets grow with the number of neighbours,
+ *        so a table fitted for a single k only applies to queries for that k.
+ */
+class RecallCalibration {
+  /**
+   * @brief Entries of the form (recall, candidates) in ascending order by recall
+   */
+  std::vector<std::pair<float, ui32>> table;
+
+  // The number of nearest neighbours the table was fitted for, 0 if it applies to every k
+  ui32 k = 0;
+
+public:
+  // z-score of the one-sided confidence bound on the mean recall used by fit (95%)
+  static constexpr float DEFAULT_Z = 1.645f;
+
+  inline bool empty() const noexcept { return table.empty(); }
+
+  inline const std::vector<std::pair<float, ui32>>& entries() const noexcept { return table; }
+
+  inline ui32 get_k() const noexcept { return k; }
+
+  /**
+   * @brief Restricts the table to queries for @k nearest neighbours, 0 applies it to every k
+   */
+  inline void set_k(ui32 k) noexcept { this->k = k; }
+
+  /**
+   * @brief Sets the number of @candidates needed to reach @recall
+   */
+  void set(float recall, ui32 candidates) {
+    auto it = std::lower_bound(ALL(table), recall, [](const auto& e, float r) { return e.first < r; });
+    if (it != table.end() && it->first == recall) it->second = candidates;
+    else table.emplace(it, recall, candidates);
+  }
+
+  /**
+   * @brief Returns the number of candidates needed to reach @recall, linearly interpolated
+   *        between the calibrated recalls.
+   * @returns UINT32_MAX if the table is empty or @recall exceeds the largest calibrated recall
+   */
+  ui32 budget(float recall) const noexcept {
+    auto it = std::lower_bound(ALL(table), recall, [](const auto& e, float r) { return e.first < r; });
+    if (it == table.end()) return UINT32_MAX;
+    if (it == table.begin() || it->first == recall) return it->second;
+
+    const auto& [r0, c0] = *(it - 1);
+    const auto& [r1, c1] = *it;
+    const double t = ((double) recall - r0) / ((double) r1 - r0);
+    return std::ceil(c0 + t * ((double) c1 - c0));
+  }
+
+  /**
+   * @brief Returns the number of candidates a query for @k nearest neighbours needs to reach @recall
+   * @returns UINT32_MAX if the table does not apply to @k, see budget(recall)
+   */
+  ui32 budget(float recall, ui32 k) const noexcept {
+    if (this->k && this->k != k) return UINT32_MAX;
+    return this->budget(recall);
+  }
+
+  /**
+   * @brief Fits a calibration table from recalls measured on a sample of queries.
+   *        For each requested recall the smallest measured number of candidates is chosen for which
+   *        a one-sided confidence bound on the mean recall of the sample meets the requested recall.
+   *        Recalls that are never met are left out of the table.
+   * @param measurements Pairs of (candidates, recall of every sample query when stopped at candidates)
+   *                     in ascending order by candidates
+   * @param recalls The recalls to calibrate
+   * @param z z-score of the confidence bound, 0 calibrates on the mean recall
+   */
+  static RecallCalibration fit(const std::vector<std::pair<ui32, std::vector<float>>>& measurements,
+                               const std::vector<float>& recalls,
+                               float z = DEFAULT_Z)
+  {
+    RecallCalibration ret;
+    for (const float r : recalls) {
+      for (const auto& [candidates, achieved] : measurements) {
+        if (RecallCalibration::confidence_bound(achieved, z) >= r) {
+          ret.set(r, candidates);
+          break;
+        }
+      }
+    }
+    return ret;
+  }
+
+  /**
+   * @returns A one-sided confidence bound on the mean of @achieved
+   */
+  static float confidence_bound(const std::vector<float>& achieved, float z = DEFAULT_Z) {
+    if (achieved.empty()) return 0.0;
+    return Util::mean(ALL(achieved)) - z * Util::std_dev(ALL(achieved)) / std::sqrt((double) achieved.size());
+  }
+};
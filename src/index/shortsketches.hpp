@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <span>
+
+#include "../global.hpp"
+#include "point.hpp"
+
+/**
+ * @brief Short secondary sketches of the points of an index, made of a selection of at most MAX_BITS of
+ *        their dimensions and stored contiguously. The hamming distance between two short sketches
+ *        is a lower bound on the distance between their points, such that candidates can be rejected
+ *        without reading the full point. At 128 bits the short sketches of 10M points take 160 MB,
+ *        which mostly stays in cache while the 1.28 GB of full 1024-bit points does not.
+ * @tparam D dimension of the points
+ */
+template<ui32 D>
+class ShortSketches {
+public:
+  // Largest number of selected dimensions
+  static constexpr ui32 MAX_BITS = 256,
+                        MAX_WORDS = MAX_BITS / 64;
+
+  // Number of points sampled by select_dims
+  static constexpr ui32 SELECT_SAMPLE = 1 << 16;
+
+  // The short sketch of a single point
+  using Sketch = std::array<ui64, MAX_WORDS>;
+
+private:
+  std::vector<ui32> dims; // the selected dimensions, bit i of a short sketch is dimension dims[i] of the point
+  ui32 words = 0;         // number of words in a short sketch
+  std::vector<ui64> data; // data[i * words .. (i+1) * words) : short sketch of point i
+
+public:
+  ShortSketches() = default;
+
+  explicit ShortSketches(std::vector<ui32> dims) : dims(std::move(dims)), words((this->dims.size() + 63) / 64) {
+    assert(this->dims.size() <= MAX_BITS);
+  }
+
+  /**
+   * @brief Selects the @bits dimensions whose values vary the most over a sample of @points, that is
+   *        whose fraction of set bits is closest to 1/2, since constant dimensions never separate points
+   * @returns The selected dimensions in ascending order
+   */
+  static std::vector<ui32> select_dims(std::span<const Point<D>> points, ui32 bits) {
+    assert(bits <= std::min(D, MAX_BITS));
+    const ui64 stride = std::max<ui64>(1, points.size() / SELECT_SAMPLE);
+    std::vector<ui64> ones(D, 0);
+    ui64 sampled = 0;
+    for (ui64 i = 0; i < points.size(); i += stride, ++sampled) {
+      for (ui32 d = points[i]._Find_first(); d < D; d = points[i]._Find_next(d)) ++ones[d];
+    }
+
+    // Order the dimensions by |2 * ones - sampled|, which is smallest for balanced dimensions
+    std::vector<std::pair<ui64, ui32>> imbalance(D);
+    for (ui32 d = 0; d < D; ++d) {
+      imbalance[d] = { 2 * ones[d] > sampled ? 2 * ones[d] - sampled : sampled - 2 * ones[d], d };
+    }
+    std::sort(ALL(imbalance));
+
+    std::vector<ui32> ret(bits);
+    std::transform(imbalance.begin(), imbalance.begin() + bits, ret.begin(), [](const auto& e) { return e.second; });
+    std::sort(ALL(ret));
+    return ret;
+  }
+
+  /**
+   * @returns Number of selected dimensions, 0 if the sketches are disabled
+   */
+  inline ui32 bits() const noexcept { return dims.size(); }
+
+  /**
+   * @returns Number of short sketches
+   */
+  inline ui64 size() const noexcept { return words ? data.size() / words : 0; }
+
+  /**
+   * @returns Number of bytes used by the short sketches
+   */
+  inline ui64 bytes() const noexcept { return data.size() * sizeof(ui64); }
+
+  /**
+   * @returns The short sketch of @p
+   */
+  Sketch project(const Point<D>& p) const noexcept {
+    Sketch ret{};
+    for (ui32 i = 0; i < dims.size(); ++i) {
+      ret[i / 64] |= (ui64) p[dims[i]] << (i % 64);
+    }
+    return ret;
+  }
+
+  /**
+   * @brief Replaces the short sketches by those of @points
+   */
+  void assign(std::span<const Point<D>> points) {
+    data.clear();
+    data.reserve(points.size() * words);
+    for (const auto& p : points) this->push_back(p);
+  }
+
+  /**
+   * @brief Appends the short sketch of @p
+   */
+  void push_back(const Point<D>& p) {
+    const Sketch s = this->project(p);
+    data.insert(data.end(), s.begin(), s.begin() + words);
+  }
+
+  /**
+   * @returns The hamming distance between the short sketch @q and the short sketch of point @i,
+   *          which is at most the distance between the points
+   */
+  inline ui32 distance(const Sketch& q, ui32 i) const noexcept {
+    const ui64* s = data.data() + (ui64) i * words;
+    ui32 dist = 0;
+    for (ui32 w = 0; w < words; ++w) dist += std::popcount(q[w] ^ s[w]);
+    return dist;
+  }
+};
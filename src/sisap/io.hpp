@@ -1,47 +1,42 @@
 #pragma once
 #include "../dataset/load.hpp"
+#include <span>
 
 /**
  * @brief Save results to HDF5 file
+ * @param knns knns[q*k + i] : id of the i'th nearest neighbour of query q, row-major of size nq * k
+ * @param dists dists[q*k + i] : distance of knns[q*k + i] to query q
  **/
 inline static void save_results_to_hdf5(
     std::string file_path,
-    std::vector<std::vector<std::pair<ui32, ui32>>> results,
+    std::span<const ui32> knns,
+    std::span<const ui32> dists,
+    ui32 nq, ui32 k,
     DataSize size,
     float build_time, float query_time,
     std::string hyperparams_description 
 ) {
+  assert(knns.size() == (ui64) nq * k && dists.size() == (ui64) nq * k);
+
   // Constants
   const std::string FOLDER_NAME = "/swann/result/";
   const std::string ALGO_NAME = "swann";
   const std::string DATA_NAME = "hammingv2";
-  constexpr ui32 outer_dims = 10000; // 10k queries
-  constexpr ui32 inner_dims = 10; // 10 closest neighbours
 
   // Create file
   H5::H5File file(FOLDER_NAME + file_path, H5F_ACC_TRUNC);
 
   // Create dataspace
-  hsize_t dims[2] = {outer_dims, inner_dims};
+  hsize_t dims[2] = {nq, k};
   H5::DataSpace dataspace(2, dims);
 
   // Create dataset
   H5::DataSet *knns_dataset  = new H5::DataSet(file.createDataSet("knns",  H5::PredType::NATIVE_UINT32, dataspace));
   H5::DataSet *dists_dataset = new H5::DataSet(file.createDataSet("dists", H5::PredType::NATIVE_UINT32, dataspace));
 
-  // Write results data to dists and knns
-  ui32 dists[outer_dims][inner_dims], knns[outer_dims][inner_dims];
-  for (ui32 i = 0; i < outer_dims; i++) {
-    for (ui32 j = 0; j < inner_dims; j++) {
-      auto &[idx, dist] = results[i][j];
-      dists[i][j] = dist;
-      knns[i][j]  = idx;
-    }
-  }
-  
-  // Save results
-  knns_dataset->write(&knns[0], H5::PredType::NATIVE_UINT32);
-  dists_dataset->write(&dists[0], H5::PredType::NATIVE_UINT32);
+  // Save results, the buffers are already in the row-major layout of the datasets
+  knns_dataset->write(knns.data(), H5::PredType::NATIVE_UINT32);
+  dists_dataset->write(dists.data(), H5::PredType::NATIVE_UINT32);
 
   // Create attributes
   H5::StrType strdatatype(H5::PredType::C_S1, 1000);
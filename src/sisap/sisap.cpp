@@ -13,7 +13,12 @@
 
 #include "./io.hpp"
 
-int main()
+/**
+ * @brief Builds the index on the sisap dataset and answers the sisap queries
+ * @tparam D Number of bits in the sketches of the dataset
+ */
+template<ui32 D>
+int run()
 {
   // Parameters
   DataSize dataset_size = DataSize::XL;
@@ -27,6 +32,9 @@ int main()
 
   const ui32 optimization_steps = 20;
 
+  // Deepest chain of a map, chains deeper than 32 hash functions are stored with 64-bit bucket keys
+  const ui32 max_depth = MAX_CHAIN_DEPTH;
+
   // Run
   srand(time(NULL));
 
@@ -39,7 +47,7 @@ int main()
 
   const float depth_val = std::min(
     std::ceil(log(dataset.size()) / log(1 / P2)),
-    30.0
+    (double) max_depth
   );
 
   const ui32 depth = depth_val;
@@ -56,7 +64,11 @@ int main()
   
   auto start_build = std::chrono::high_resolution_clock::now();
 
-  LSHForest<D> *index = new LSHForest<D>(maps, dataset, SingleBitFailure<D>);
+  // The index copies the points into huge pages, after which the loaded dataset is released
+  LSHForest<D> *index = new LSHForest<D>(maps, dataset, SingleBitFailure<D>, PointStoreConfig{ .huge_pages = true, .prefault = true });
+  PointsDataset<D>().swap(dataset);
+  // Exact duplicates are collapsed before building, such that the maps index every distinct sketch once
+  std::cout << "Collapsed duplicates: " << index->deduplicate() << std::endl;
   index->build();
 
   auto end_build = std::chrono::high_resolution_clock::now();
@@ -71,25 +83,30 @@ int main()
   std::cout << "Answering queries with multiple threads..." << std::endl;
 
   // Query
+  const ui32 nq = queries.size();
+  std::vector<ui32> knns(nq * nrToQuery), dists(nq * nrToQuery);
   auto start = std::chrono::high_resolution_clock::now();
-  std::vector<std::vector<ui32>> query_result = index->mthread_queries(queries, nrToQuery, recall);
+  index->query_into(queries, nrToQuery, recall, knns, dists, QueryOrder::MapKey);
   auto end = std::chrono::high_resolution_clock::now();
   total_time = std::chrono::duration_cast<std::chrono::duration<double>>(end - start).count();
 
-  std::vector<std::vector<std::pair<ui32, ui32>>> results(queries.size(), std::vector<std::pair<ui32, ui32>>(nrToQuery));
-
-  for (int i = 0; i < results.size(); ++i) {
-    // Vector of pairs of { point index, distance to query point } 
-    std::transform(ALL(query_result[i]), results[i].begin(), [&index, &queries, &i](ui32 j)
-          { return std::pair<ui32,ui32>(j+1, queries[i].distance((*index)[j])); });
-  }
+  // Point ids are 1-indexed in the results
+  for (auto& id : knns) id += id != UINT32_MAX;
 
   // Save results
   std::cout << "Saving results" << std::endl;
   std::stringstream ss;
 
   ss << "P1=" << P1 << ", P2=" << P2 << ", depth=" << depth << ", tries=" << count << ", optimization_steps=" << optimization_steps;
-  save_results_to_hdf5("results_test.h5", results, dataset_size, total_build_time, total_time, ss.str());
+  save_results_to_hdf5("results_test.h5", knns, dists, nq, nrToQuery, dataset_size, total_build_time, total_time, ss.str());
 
   return 0;
 }
+
+int main()
+{
+  // The width of the sketches selects the instantiation of the index
+  const ui32 dimensions = get_sketch_dimensions(fetch_sisap_points_dataset());
+  std::cout << "Sketch dimensions: " << dimensions << std::endl;
+  return dispatch_dimension(dimensions, [](auto dim) { return run<decltype(dim)::value>(); });
+}
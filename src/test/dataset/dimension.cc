@@ -0,0 +1,18 @@
+#include <gtest/gtest.h>
+
+#include "../../dataset/dimension.hpp"
+#include "../../index/point.hpp"
+
+TEST(DispatchDimension, CallsTheInstantiationOfTheDimension) {
+  for (ui32 dim : SKETCH_DIMENSIONS) {
+    // Act
+    const ui32 words = dispatch_dimension(dim, [](auto d) { return Point<decltype(d)::value>::WORDS; });
+
+    // Assert
+    ASSERT_EQ(words, dim / 64);
+  }
+}
+
+TEST(DispatchDimension, ThrowsForUnsupportedDimensions) {
+  ASSERT_THROW(dispatch_dimension(100, [](auto d) { return d(); }), std::invalid_argument);
+}
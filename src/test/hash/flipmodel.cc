@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "../../hash/flipmodel.hpp"
+#include "../../hash/hashfamilyfactory.hpp"
+
+constexpr ui32 D = 8;
+
+TEST(FlipModel, FitsFlipRatesOfNearNeighbours) {
+  // Arrange : the near neighbours of the query only differ from it in dimension 0 and 1
+  std::vector<Point<D>> points = { 
+    Point<D>(0b00000001), Point<D>(0b00000010), Point<D>(0b00000001), Point<D>(0b11110000),
+  };
+  std::vector<Point<D>> queries = { Point<D>(0b00000000) };
+  std::vector<std::vector<ui32>> answers = { { 1, 1, 1, 4 } };
+
+  // Act
+  auto model = FlipModel<D>::fit(points, queries, answers, 3);
+
+  // Assert : Laplace smoothed rates over 3 neighbour pairs
+  ASSERT_FLOAT_EQ(model.rate(0), FlipModel<D>::MAX_RATE); // 3 / 5, clamped
+  ASSERT_NEAR(model.rate(1), 2.0 / 5.0, 1e-6);
+  ASSERT_NEAR(model.rate(7), 1.0 / 5.0, 1e-6);
+  ASSERT_LT(model.score(0), model.score(1));
+  ASSERT_LT(model.score(1), model.score(7));
+  ASSERT_GT(model.score(0), 0.0f);
+}
+
+TEST(FlipModel, ApplyReplacesMarginsOfSingleBitHashes) {
+  // Arrange
+  std::vector<float> rates(D, 0.1f);
+  rates[3] = 0.4f;
+  FlipModel<D> model(rates);
+
+  HashFamily<D> hf = HashFamilyFactory<D>::createRandomBits(D);
+  hf.push_back([](const Point<D>& p) { return p[0] && p[1]; }, 
+               { UINT32_MAX, [](const Point<D>& p) { return p[0] && p[1] ? 1.0f : -7.0f; } });
+
+  // Act
+  model.apply(hf);
+
+  // Assert : hashes are unchanged, and bit margins carry the score of their dimension
+  std::vector<float> flips;
+  for (ui32 i = 0; i < 100; ++i) {
+    const auto p = Point<D>::random(0.5);
+    ASSERT_EQ(hf.hash_with_margins(p, flips), hf(p));
+    for (ui32 j = 0; j < D; ++j) {
+      ASSERT_FLOAT_EQ(flips[j], model.score(hf.info(j).dim));
+    }
+    if (!(p[0] && p[1])) {
+      ASSERT_FLOAT_EQ(flips[D], 7.0f);
+    }
+  }
+}
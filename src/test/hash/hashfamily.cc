@@ -110,4 +110,23 @@ TEST(HashFamily, Spread_Correctness_Independent) {
   // exp is computed by using online calculator to compute population variance of range [0,0,0.25,0.25,0.25,0.25]
   double exp = 0.12909944d;
   ASSERT_NEAR(exp, H.spread(ALL(in)), 0.00000001d);
-}
\ No newline at end of file
+}
+TEST(HashFamily, SliceAndConcatenationKeepHashInfo) {
+  // Arrange
+  auto HF = HashFamilyFactory<D>::createRandomBits(D);
+  ASSERT_TRUE(HF.has_margins());
+
+  // Act
+  auto lo = HF.slice(0, 2), hi = HF.slice(2, D);
+  auto cat = lo;
+  cat += hi;
+
+  // Assert
+  ASSERT_TRUE(lo.has_margins() && hi.has_margins() && cat.has_margins());
+  ASSERT_EQ(hi.info(0).dim, HF.info(2).dim);
+  for (ui32 i = 0; i < D; ++i) {
+    ASSERT_EQ(cat.info(i).dim, HF.info(i).dim);
+    ASSERT_LT(cat.info(i).dim, D);
+  }
+  ASSERT_FALSE(H.has_margins());
+}
@@ -64,3 +64,19 @@ TEST(HashFamilyFactoryCreate, ConstructsHFContaining_SizeHashFunctions_ifSizeIsD
   // Assert
   ASSERT_EQ(HF.size(), N);
 }
+
+TEST(HashFamilyFactoryCreate, MarginsAgreeWithHashValues)
+{
+  // Arrange
+  const ui32 N = 12;
+  auto HF = HashFamilyFactory<D>::create(N, HashType::Bit | HashType::Mask | HashType::Hamming);
+  ASSERT_TRUE(HF.has_margins());
+
+  // Act & Assert : the sign of the margin of every hash function is its value, for every point
+  std::vector<float> flips;
+  for (ui32 i = 0; i < 100; ++i) {
+    const auto p = Point<D>::random(0.5);
+    ASSERT_EQ(HF.hash_with_margins(p, flips), HF(p));
+    ASSERT_EQ(flips.size(), N);
+  }
+}
@@ -0,0 +1,90 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "../../hash/supervisedhashfamilyfactory.hpp"
+#include "../../hash/hashfamilyfactory.hpp"
+
+constexpr ui32 D = 16;
+
+// Bits [0, NOISY) differ between neighbours, bits [NOISY, D) never do
+constexpr ui32 NOISY = 8;
+
+static std::vector<Point<D>> createSample(ui32 n) {
+  std::vector<Point<D>> ret;
+  for (ui32 i = 0; i < n; ++i) ret.push_back(Point<D>::random(0.5));
+  return ret;
+}
+
+static HashFamily<D> createDimensionBits() {
+  HashFamily<D> hf;
+  for (ui32 i = 0; i < D; ++i) {
+    hf.push_back([i](const Point<D>& p) { return p[i]; }, 
+                 { i, [i](const Point<D>& p) { return p[i] ? 1.0f : -1.0f; } });
+  }
+  return hf;
+}
+
+TEST(SupervisedHashFamilyFactory, ChoosesBitsThatKeepNeighboursTogether) {
+  // Arrange : neighbours are the points with a random subset of the noisy bits flipped
+  auto sample = createSample(256);
+  std::vector<SupervisedHashFamilyFactory<D>::PointPair> pairs;
+  for (auto& p : sample) {
+    Point<D> q = p;
+    for (ui32 i = 0; i < NOISY; ++i) q[i] = rand() & 1;
+    pairs.emplace_back(p, q);
+  }
+
+  // Act
+  const ui32 depth = 4, count = 2;
+  auto hf = SupervisedHashFamilyFactory<D>::create(sample, pairs, createDimensionBits(), depth, count);
+
+  // Assert : every chain reads only bits that neighbours agree on, keeps its info, and the chains
+  //          split the clean bits between them rather than repeating the first chain
+  ASSERT_EQ(hf.size(), depth * count);
+  std::set<ui32> dims;
+  for (ui32 i = 0; i < hf.size(); ++i) {
+    ASSERT_GE(hf.info(i).dim, NOISY);
+    dims.insert(hf.info(i).dim);
+  }
+  ASSERT_EQ(dims.size(), D - NOISY);
+  for (auto& [p, q] : pairs) {
+    ASSERT_EQ(hf.slice(0, depth)(p), hf.slice(0, depth)(q));
+  }
+}
+
+TEST(SupervisedHashFamilyFactory, BalancePenaltyRejectsConstantHashes) {
+  // Arrange : a constant hash keeps every pair together but splits no bucket
+  auto sample = createSample(256);
+  std::vector<SupervisedHashFamilyFactory<D>::PointPair> pairs;
+  for (auto& p : sample) pairs.emplace_back(p, p);
+
+  HashFamily<D> pool;
+  pool.push_back([](const Point<D>&) { return true; });
+  pool += createDimensionBits().slice(0, 2);
+
+  // Act
+  auto hf = SupervisedHashFamilyFactory<D>::create(sample, pairs, pool, 2, 1);
+
+  // Assert
+  ASSERT_EQ(hf.info(0).dim + hf.info(1).dim, 0 + 1);
+}
+
+TEST(SupervisedHashFamilyFactory, KnnPairsContainTheNearestPoints) {
+  // Arrange
+  std::vector<Point<D>> points = { Point<D>(0b0000), Point<D>(0b0001), Point<D>(0b0011), Point<D>(0b1111) };
+  std::vector<Point<D>> queries = { Point<D>(0b0000) };
+
+  // Act
+  auto pairs = SupervisedHashFamilyFactory<D>::knn_pairs(points, queries, { { 0, 1 } }, 2);
+  auto sampled = SupervisedHashFamilyFactory<D>::knn_pairs(points, 4, 1);
+
+  // Assert
+  ASSERT_EQ(pairs.size(), 2);
+  ASSERT_EQ(pairs[1].second, points[1]);
+  ASSERT_EQ(sampled.size(), 4);
+  for (auto& [p, q] : sampled) {
+    ASSERT_NE(p, q);
+    ASSERT_LE(p.distance(q), 2);
+  }
+}
@@ -0,0 +1,83 @@
+#include <gtest/gtest.h>
+
+#include "util.hpp"
+#include "../../index/bucketmask.hpp"
+#include "../../index/asyncqueryengine.hpp"
+
+TEST(AsyncQueryEngine, FuturesReturnResultOfBatchQuery) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  AsyncQueryConfig config;
+  config.k = 3;
+  config.recall = 1.0;
+  config.queue_capacity = 4;
+  AsyncQueryEngine<D> engine(forest, config);
+
+  // Act
+  std::vector<std::future<std::vector<ui32>>> futures;
+  for (auto& p : points) {
+    futures.push_back(engine.submit(p));
+  }
+
+  // Assert
+  for (ui32 i = 0; i < points.size(); ++i) {
+    auto result = futures[i].get();
+    ASSERT_EQ(result.size(), config.k);
+    for (auto& pidx : result) {
+      ASSERT_LE(points[i].distance(forest[pidx]), 2);
+    }
+  }
+}
+
+TEST(AsyncQueryEngine, CallbacksAreCalledForAllPendingQueries) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  std::atomic<ui32> answered(0);
+  AsyncQueryConfig config;
+  config.k = 1;
+  config.max_delay = std::chrono::milliseconds(50);
+
+  // Act : Destroying the engine answers all pending queries
+  {
+    AsyncQueryEngine<D> engine(forest, config);
+    for (auto& p : points) {
+      ASSERT_TRUE(engine.try_submit(p, [&answered](std::vector<ui32> res) {
+        if (res.size() == 1) ++answered;
+      }));
+    }
+  }
+
+  // Assert
+  ASSERT_EQ(answered.load(), points.size());
+}
+
+TEST(AsyncQueryEngine, FailingCallbacksDoNotStopTheDispatcher) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  AsyncQueryEngine<D> engine(forest);
+
+  // Act
+  engine.submit(points[0], [](std::vector<ui32>) { throw std::runtime_error("callback failed"); });
+  auto result = engine.submit(points[1]).get();
+
+  // Assert : later queries are still answered, and the error of the callback is kept
+  ASSERT_FALSE(result.empty());
+  std::exception_ptr err = engine.take_error();
+  ASSERT_TRUE(err);
+  ASSERT_THROW(std::rethrow_exception(err), std::runtime_error);
+  ASSERT_FALSE(engine.take_error());
+}
@@ -41,3 +41,40 @@ TEST(BFIndexTest, ReturnsTrueKNN) {
   // Assert
   ASSERT_TRUE(std::equal(ALL(actual), ALL(exp)));
 }
+
+TEST(BFIndexTest, BatchQueryReturnsResultOfEachQuery) {
+  // Arrange
+  std::vector<Point<4>> input = {
+      Point<4>(0b1100),
+      Point<4>(0b1110),
+      Point<4>(0b0001),
+      Point<4>(0b0010),
+  };
+  BFIndex<4> index(input);
+  std::vector<Point<4>> queries = { Point<4>(0b0011), Point<4>(0b1100) };
+
+  // Act
+  auto actual = index.batch_query(queries, 2, 1.0);
+
+  // Assert
+  ASSERT_EQ(actual.size(), queries.size());
+  for (ui32 q = 0; q < queries.size(); ++q) {
+    ASSERT_EQ(actual[q], index.query(queries[q], 2));
+  }
+}
+
+TEST(BFIndexTest, QueryIntoPadsRowsWithFewerResults) {
+  // Arrange
+  std::vector<Point<4>> input = { Point<4>(0b1100), Point<4>(0b0001) };
+  BFIndex<4> index(input);
+  std::vector<Point<4>> queries = { Point<4>(0b1101), Point<4>(0b0000) };
+  const ui32 k = 3;
+  std::vector<ui32> ids(queries.size() * k), dists(queries.size() * k);
+
+  // Act
+  index.query_into(queries, k, 1.0, ids, dists);
+
+  // Assert
+  ASSERT_EQ(ids, std::vector<ui32>({ 0, 1, UINT32_MAX, 1, 0, UINT32_MAX }));
+  ASSERT_EQ(dists, std::vector<ui32>({ 1, 2, UINT32_MAX, 1, 2, UINT32_MAX }));
+}
@@ -74,9 +74,10 @@ TEST(LSHArrayMapTest, BucketCanContainMultiplePoints) {
   // Act
   mp.add(Point<D>(0b101));
   auto bucket_hash = mp.hash(Point<D>(0b101));
-  std::vector<ui32> bucket = mp.query(bucket_hash);
+  std::vector<hash_idx> bucket = mp.query(bucket_hash);
 
-  auto actual = mp[bucket.front()];
+  auto view = mp[bucket.front()];
+  std::vector<ui32> actual(ALL(view));
 
   // Assert
   std::vector<ui32> expected = { 5, (ui32) input.size() };
@@ -93,7 +94,7 @@ TEST(LSHArrayMapTest, QueryReturnsCorrectHammingDistanceOfBucketId)
 
   // Act
   for (int i = 0; i < H.size(); ++i) {
-    std::vector<ui32> buckets = mp.query(bucket_hash, i);
+    std::vector<hash_idx> buckets = mp.query(bucket_hash, i);
 
     // Assert
     for (auto& bucket : buckets) {
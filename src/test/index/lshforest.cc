@@ -100,4 +100,568 @@ TEST(LSHForestQuery, MThread_QueryReturnsCorrectResults) {
       ASSERT_EQ(mt_results[q][i], st_result[i]);
     }
   }
-}
\ No newline at end of file
+}
+
+// Asserts that reordered batches return the results in the order of the queries
+TEST(LSHForestQuery, MThread_ReorderedQueriesReturnResultsInInputOrder) {
+  const ui32 k = 3;
+
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  std::vector<Point<D>> queries(points.rbegin(), points.rend());
+
+  for (auto order : { QueryOrder::MapKey, QueryOrder::ZOrder, QueryOrder::Gray }) {
+    // Act
+    auto results = forest.mthread_queries(queries, k, 1.0, 0, order);
+
+    // Assert
+    for (ui32 q = 0; q < queries.size(); ++q) {
+      ASSERT_EQ(results[q], forest.query(queries[q], k, 1.0));
+    }
+  }
+}
+
+// Asserts that queries with a context return the results of the allocating query, and that the arena stops growing
+TEST(LSHForestQuery, QueryWithContextMatchesQuery) {
+  const ui32 k = 5;
+
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  QueryContext<D> ctx(64);
+
+  for (ui32 round = 0; round < 2; ++round) {
+    const ui64 arena_size = ctx.arena_size();
+    for (auto& p : points) {
+      // Act
+      auto result = forest.query(p, k, 1.0, ctx);
+
+      // Assert
+      ASSERT_EQ(std::vector<ui32>(ALL(result)), forest.query(p, k, 1.0));
+    }
+    if (round) {
+      ASSERT_EQ(ctx.arena_size(), arena_size);
+    }
+  }
+}
+
+// Asserts that query_into writes the results and their distances in the order of the queries
+TEST(LSHForestQuery, QueryIntoWritesIdsAndDistances) {
+  const ui32 k = 3;
+
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  std::vector<Point<D>> queries(points.rbegin(), points.rend());
+  std::vector<ui32> ids(queries.size() * k), dists(queries.size() * k);
+
+  // Act
+  forest.query_into(queries, k, 1.0, ids, dists, QueryOrder::MapKey);
+
+  // Assert
+  for (ui32 q = 0; q < queries.size(); ++q) {
+    auto exp = forest.query(queries[q], k, 1.0);
+    for (ui32 i = 0; i < k; ++i) {
+      ASSERT_EQ(ids[q*k + i], exp[i]);
+      ASSERT_EQ(dists[q*k + i], queries[q].distance(forest[exp[i]]));
+    }
+  }
+}
+
+// Asserts that both probe schedules find the exact nearest neighbours when every bucket may be probed
+TEST(LSHForestQuery, ProbeSchedulesReturnCorrectResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  for (auto schedule : { ProbeSchedule::Lockstep, ProbeSchedule::Yield }) {
+    forest.set_probe_schedule(schedule);
+    for (auto& p : points) {
+      // Act
+      QueryLog log;
+      auto result = forest.query(p, 5, 1.0, &log);
+
+      // Assert : the 5 nearest are p and its 4 neighbours at distance 1
+      ASSERT_EQ(result.size(), 5);
+      for (auto& pidx : result) {
+        ASSERT_LE(p.distance(forest[pidx]), 1);
+      }
+      ASSERT_EQ(log.found, points.size() - 1);
+    }
+  }
+}
+
+TEST(LSHForestQuery, TrainedFlipModelKeepsResultsCorrect) {
+  // Arrange : single-bit hashes with known dimensions, such that the maps probe by their margins
+  HashFamily<D> bits;
+  for (ui32 i = 0; i < D; ++i) {
+    bits.push_back([i](const Point<D>& p) { return p[i]; },
+                   { i, [i](const Point<D>& p) { return p[i] ? 1.0f : -1.0f; } });
+  }
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(bits, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  // Act : the 5 nearest of every point are itself and its neighbours at distance 1
+  std::vector<std::vector<ui32>> answers(points.size(), { 0, 1, 1, 1, 1 });
+  auto model = forest.train_flip_model(points, answers, 5);
+
+  // Assert
+  for (ui32 d = 0; d < D; ++d) {
+    // each of the 16 points has one of its 5 neighbours differing in dimension d
+    ASSERT_NEAR(model.rate(d), (16 + 1) / (80.0 + 2), 1e-6);
+  }
+  for (auto& p : points) {
+    QueryLog log;
+    auto result = forest.query(p, 5, 1.0, &log);
+    ASSERT_EQ(result.size(), 5);
+    for (auto& pidx : result) {
+      ASSERT_LE(p.distance(forest[pidx]), 1);
+    }
+    ASSERT_EQ(log.found, points.size() - 1);
+  }
+}
+
+TEST(LSHForestBuild, InsertedPointsAreAddedOnceOnRebuild) {
+  // Arrange : a forest over half of the points
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  const std::vector<Point<D>> half(points.begin(), points.begin() + points.size() / 2);
+  LSHForest<D> forest(maps, half);
+  forest.build();
+
+  // Act
+  for (ui32 i = half.size(); i < points.size(); ++i) forest.insert(points[i]);
+  forest.build();
+
+  // Assert : every map indexes each point once, under the index of the point in the forest
+  for (auto map : forest.getMaps()) {
+    ASSERT_EQ(map->size(), points.size());
+  }
+  for (ui32 i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(forest[i], points[i]);
+    auto result = forest.query(points[i], 1, 1.0);
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result.front(), i);
+  }
+}
+
+TEST(LSHForestBuild, ReorderKeepsExternalIds) {
+  // Arrange : a forest over half of the points
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  std::reverse(ALL(points));
+  const std::vector<Point<D>> half(points.begin(), points.begin() + points.size() / 2);
+  LSHForest<D> forest(maps, half);
+  forest.build();
+
+  // Act
+  forest.reorder(QueryOrder::MapKey);
+  for (ui32 i = half.size(); i < points.size(); ++i) forest.insert(points[i]);
+  forest.build();
+
+  // Assert : the reordered points are stored in ascending order by their key in the first map
+  const auto& stored = forest.get_points();
+  for (ui32 i = 1; i < half.size(); ++i) {
+    ASSERT_LE(forest.getMaps()[0]->hash(stored[i-1]), forest.getMaps()[0]->hash(stored[i]));
+  }
+  // Assert : queries and look ups use the ids of the points in insertion order
+  auto batch = forest.batch_query(points, 1, 1.0);
+  for (ui32 i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(forest[i], points[i]);
+    ASSERT_EQ(forest[forest.external_id(i)], stored[i]);
+    auto result = forest.query(points[i], 1, 1.0);
+    ASSERT_EQ(result.size(), 1);
+    ASSERT_EQ(result.front(), i);
+    ASSERT_EQ(batch[i].front(), i);
+  }
+}
+
+TEST(LSHForestQuery, InlinedBucketsReturnTheSameResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  const std::vector<ProbeSchedule> schedules = { ProbeSchedule::Lockstep, ProbeSchedule::Yield };
+  auto answer_all = [&]() {
+    std::vector<std::vector<std::vector<ui32>>> ret = { forest.batch_query(points, 4, 1.0) };
+    for (auto s : schedules) {
+      forest.set_probe_schedule(s);
+      ret.emplace_back();
+      for (auto& p : points) ret.back().push_back(forest.query(p, 4, 1.0));
+    }
+    return ret;
+  };
+  auto expected = answer_all();
+
+  // Act : inline every bucket of the first map
+  forest.set_inline_points(1, 1);
+
+  // Assert
+  ASSERT_EQ(forest.inlined_bytes(), points.size() * sizeof(Point<D>));
+  ASSERT_EQ(answer_all(), expected);
+
+  // Assert : the copies are refreshed by rebuilding after an insert
+  forest.insert(points[0]);
+  forest.build();
+  ASSERT_EQ(forest.inlined_bytes(), (points.size() + 1) * sizeof(Point<D>));
+}
+
+TEST(LSHForestBuild, DeduplicatedPointsExpandIntoAllTheirIds) {
+  // Arrange : points 16 and 17 duplicate point 3, and point 18 duplicates point 7
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  const ui32 distinct = points.size();
+  points.push_back(points[3]);
+  points.push_back(points[3]);
+  points.push_back(points[7]);
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  // Act
+  const ui32 collapsed = forest.deduplicate();
+  forest.reorder(QueryOrder::MapKey);
+
+  // Assert : every distinct point is stored and indexed once
+  ASSERT_EQ(collapsed, 3);
+  ASSERT_EQ(forest.size(), points.size());
+  ASSERT_EQ(forest.get_points().size(), distinct);
+  for (auto map : forest.getMaps()) {
+    ASSERT_EQ(map->size(), distinct);
+  }
+  for (ui32 i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(forest[i], points[i]);
+  }
+
+  // Assert : the duplicates are expanded into their ids, and k bounds the expansion
+  auto result = forest.query(points[3], 3, 1.0);
+  std::sort(ALL(result));
+  ASSERT_EQ(result, std::vector<ui32>({ 3, 16, 17 }));
+  ASSERT_EQ(forest.query(points[3], 2, 1.0).size(), 2);
+  auto batch = forest.batch_query({ points[7] }, 4, 1.0);
+  ASSERT_EQ(batch[0].size(), 4);
+  std::vector<ui32> exact(batch[0].begin(), batch[0].begin() + 2);
+  std::sort(ALL(exact));
+  ASSERT_EQ(exact, std::vector<ui32>({ 7, 18 }));
+  ASSERT_GT(points[7].distance(points[batch[0][2]]), 0);
+
+  std::vector<ui32> ids(3), dists(3);
+  forest.query_into({ points[3] }, 3, 1.0, ids, dists);
+  ASSERT_EQ(dists, std::vector<ui32>({ 0, 0, 0 }));
+
+  // Assert : points inserted afterwards get the next id
+  Point<D> p = points[0];
+  forest.insert(p);
+  forest.build();
+  ASSERT_EQ(forest.size(), points.size() + 1);
+  ASSERT_EQ(forest[points.size()], p);
+  result = forest.query(p, 2, 1.0);
+  std::sort(ALL(result));
+  ASSERT_EQ(result, std::vector<ui32>({ 0, (ui32) points.size() }));
+}
+
+TEST(LSHForestQuery, ExactShortSketchFilterReturnsTheSameResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  auto expected = forest.batch_query(points, 4, 1.0);
+
+  // Act
+  forest.set_short_sketches(2);
+
+  // Assert
+  ASSERT_EQ(forest.short_sketch_bytes(), points.size() * sizeof(ui64));
+  ASSERT_EQ(forest.batch_query(points, 4, 1.0), expected);
+  Point<D> p = points[5];
+  forest.insert(p);
+  forest.build();
+  ASSERT_EQ(forest.short_sketch_bytes(), (points.size() + 1) * sizeof(ui64));
+}
+
+TEST(LSHForestQuery, SummarizedBucketsAreSkippedWithoutChangingResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  forest.set_probe_schedule(ProbeSchedule::Lockstep);
+  auto scanned = [&]() {
+    ui32 ret = 0;
+    for (auto& p : points) {
+      QueryLog log;
+      forest.query(p, 1, 1.0, &log);
+      ret += log.found;
+    }
+    return ret;
+  };
+  const auto expected = forest.batch_query(points, 1, 1.0);
+  const ui32 full_scan = scanned();
+
+  // Act
+  forest.set_bucket_summaries(1);
+
+  // Assert : exact matches leave a kth distance of 0, after which every summarized bucket is skipped
+  ui32 buckets = 0;
+  for (auto map : forest.getMaps()) {
+    for (auto size : map->get_bucket_sizes()) buckets += size > 0;
+  }
+  ASSERT_EQ(forest.summary_bytes(), buckets * sizeof(BucketSummary<D>));
+  ASSERT_EQ(forest.batch_query(points, 1, 1.0), expected);
+  ASSERT_LT(scanned(), full_scan);
+  for (ui32 i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(forest.query(points[i], 1, 1.0), std::vector<ui32>({ i }));
+  }
+}
+
+TEST(LSHForestQuery, PivotFilterReturnsTheSameResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  auto expected = forest.batch_query(points, 4, 1.0);
+
+  // Act
+  forest.set_pivots(3);
+
+  // Assert
+  ASSERT_EQ(forest.pivot_bytes(), points.size() * 3 * sizeof(ui16));
+  ASSERT_EQ(forest.batch_query(points, 4, 1.0), expected);
+  Point<D> p = points[5];
+  forest.insert(p);
+  forest.build();
+  ASSERT_EQ(forest.pivot_bytes(), (points.size() + 1) * 3 * sizeof(ui16));
+}
+
+// Asserts that the batch query returns k results within the expected distance for all points
+TEST(LSHForestQuery, BatchQueryReturnsCorrectResults) {
+  // Arrange : Build all maps on all combinations of points
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  // Queries span multiple blocks
+  std::vector<Point<D>> queries;
+  while (queries.size() <= LSHForest<D>::QUERY_BLOCK_SIZE) {
+    queries.insert(queries.end(), ALL(points));
+  }
+
+  ui32 k = 0;
+  for (ui32 bits = 0; bits < D; ++bits) {
+    k += (1UL << bits);
+
+    // Act
+    auto results = forest.batch_query(queries, k, 1.0);
+
+    // Assert
+    ASSERT_EQ(results.size(), queries.size());
+    for (ui32 q = 0; q < queries.size(); ++q) {
+      ASSERT_EQ(results[q].size(), k);
+      for (auto &pidx : results[q]) {
+        ASSERT_LE(queries[q].distance(forest[pidx]), bits+1);
+      }
+    }
+  }
+}
+
+// Asserts that a query stops once its candidate budget runs out
+TEST(LSHForestQuery, BudgetLimitsCandidates) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  QueryBudget budget;
+  budget.candidates = 3;
+
+  for (auto& p : points) {
+    // Act
+    QueryLog log;
+    auto result = forest.query(p, 2, 1.0, budget, &log);
+
+    // Assert
+    ASSERT_TRUE(log.exhausted);
+    ASSERT_LE(log.found, budget.candidates);
+    ASSERT_EQ(result.size(), 2);
+  }
+}
+
+// Asserts that progressive queries emit results with improving kth distance
+TEST(LSHForestQuery, ProgressiveQueryEmitsImprovingResults) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  const ui32 k = 3;
+  for (auto& p : points) {
+    std::vector<std::pair<ui32, ui32>> emitted; // (size, kth distance) of every progressive result
+    QueryBudget budget;
+    budget.on_progress = [&](const std::vector<ui32>& res) {
+      ASSERT_LE(res.size(), k);
+      emitted.emplace_back(res.size(), p.distance(forest[res.back()]));
+    };
+
+    // Act
+    auto result = forest.query(p, k, 1.0, budget);
+
+    // Assert : every result grows or lowers the kth distance, and the k-sized results are emitted
+    ASSERT_FALSE(emitted.empty());
+    for (ui32 i = 1; i < emitted.size(); ++i) {
+      ASSERT_TRUE(emitted[i].first > emitted[i-1].first || emitted[i].second < emitted[i-1].second);
+    }
+    ASSERT_EQ(emitted.back().first, k);
+    ASSERT_EQ(emitted.back().second, p.distance(forest[result.back()]));
+  }
+}
+
+// Asserts that progressive results hold external ids after the points are renumbered and deduplicated
+TEST(LSHForestQuery, ProgressiveResultsHoldExternalIds) {
+  // Arrange : point 16 duplicates point 3
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  points.push_back(points[3]);
+  LSHForest<D> forest(maps, points);
+  forest.build();
+  forest.reorder(QueryOrder::MapKey);
+  forest.deduplicate();
+
+  std::vector<ui32> last;
+  QueryBudget budget;
+  budget.on_progress = [&](const std::vector<ui32>& res) { last = res; };
+
+  // Act
+  auto result = forest.query(points[3], 2, 1.0, budget);
+
+  // Assert
+  std::sort(ALL(last));
+  std::sort(ALL(result));
+  ASSERT_EQ(last, std::vector<ui32>({ 3, 16 }));
+  ASSERT_EQ(result, last);
+}
+
+// Asserts that a calibrated forest reaches the calibrated recall on the calibration queries
+TEST(LSHForestCalibrate, CalibratedQueriesReachRecall) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  const ui32 k = 2;
+  std::vector<std::vector<ui32>> answers;
+  for (auto& q : points) {
+    std::vector<ui32> dists;
+    for (auto& p : points) dists.push_back(q.distance(p));
+    std::sort(ALL(dists));
+    answers.emplace_back(dists.begin(), dists.begin() + k);
+  }
+
+  // Act
+  auto& calibration = forest.calibrate(points, answers, k, { 1.0 });
+
+  // Assert
+  ASSERT_FALSE(calibration.empty());
+  ASSERT_FALSE(forest.get_batch_calibration().empty());
+  auto batch = forest.batch_query(points, k, 1.0);
+  for (ui32 q = 0; q < points.size(); ++q) {
+    auto result = forest.query(points[q], k, 1.0);
+    ASSERT_EQ(result.size(), k);
+    ASSERT_EQ(batch[q].size(), k);
+    for (ui32 i = 0; i < k; ++i) {
+      ASSERT_LE(points[q].distance(forest[result[i]]), answers[q][k-1]);
+      ASSERT_LE(points[q].distance(forest[batch[q][i]]), answers[q][k-1]);
+    }
+  }
+
+  // Assert : queries for another k are not stopped by the calibrated budgets
+  ASSERT_EQ(calibration.get_k(), k);
+  for (auto& p : points) {
+    ASSERT_EQ(forest.query(p, 2 * k, 1.0).size(), 2 * k);
+  }
+  for (auto& res : forest.batch_query(points, 2 * k, 1.0)) {
+    ASSERT_EQ(res.size(), 2 * k);
+  }
+
+  // Assert : a budget below k does not stop a query before it holds k points
+  RecallCalibration tiny;
+  tiny.set(1.0, 1);
+  forest.set_calibration(tiny);
+  forest.set_batch_calibration(tiny);
+  ASSERT_EQ(forest.query(points[0], 2 * k, 1.0).size(), 2 * k);
+  ASSERT_EQ(forest.batch_query({ points[0] }, 2 * k, 1.0)[0].size(), 2 * k);
+
+  // Assert : the calibration of single queries is dropped with the schedule it was fitted under
+  forest.set_probe_schedule(ProbeSchedule::Yield);
+  ASSERT_TRUE(forest.get_calibration().empty());
+  ASSERT_FALSE(forest.get_batch_calibration().empty());
+}
+
+// Asserts that cached queries return the uncached results, and that inserting points invalidates the cache
+TEST(LSHForestCache, CachedQueriesMatchUncachedQueries) {
+  // Arrange
+  BucketMask masks(2U);
+  std::vector<LSHMap<D>*> maps = LSHMapFactory<D>::create(H, masks, 2, 2);
+  std::vector<Point<D>> points = createCompleteInput();
+  LSHForest<D> forest(maps, points);
+  forest.build();
+
+  const ui32 k = 3, N = points.size();
+  auto expected_batch = forest.batch_query(points, k, 1.0);
+  std::vector<std::vector<ui32>> expected_single;
+  for (auto& p : points) expected_single.push_back(forest.query(p, k, 1.0));
+  forest.enable_cache();
+
+  // Act : every path misses once and then hits its own results
+  for (ui32 round = 0; round < 2; ++round) {
+    auto batch = forest.batch_query(points, k, 1.0);
+    for (ui32 q = 0; q < N; ++q) {
+      ASSERT_EQ(batch[q], expected_batch[q]);
+      ASSERT_EQ(forest.query(points[q], k, 1.0), expected_single[q]);
+    }
+  }
+
+  // Assert : single and batch results are cached apart
+  auto stats = forest.get_cache()->stats();
+  ASSERT_EQ(stats.misses, 2 * N);
+  ASSERT_EQ(stats.hits, 2 * N);
+  ASSERT_EQ(stats.entries, 2 * N);
+
+  Point<D> p = points.front();
+  forest.insert(p);
+  forest.query(p, k, 1.0);
+  ASSERT_EQ(forest.get_cache()->stats().misses, 2 * N + 1);
+}
@@ -74,9 +74,10 @@ TEST(LSHHashMapTest, BucketCanContainMultiplePoints) {
   // Act
   mp.add(Point<D>(0b101));
   auto bucket_hash = mp.hash(Point<D>(0b101));
-  std::vector<ui32> bucket = mp.query(bucket_hash);
+  std::vector<hash_idx> bucket = mp.query(bucket_hash);
 
-  auto actual = mp[bucket.front()];
+  auto view = mp[bucket.front()];
+  std::vector<ui32> actual(ALL(view));
 
   // Assert
   std::vector<ui32> expected = { 5, (ui32) input.size() };
@@ -93,7 +94,7 @@ TEST(LSHHashMapTest, QueryReturnsCorrectHammingDistanceOfBucketId)
 
   // Act
   for (int i = 0; i < H.size(); ++i) {
-    std::vector<ui32> buckets = mp.query(bucket_hash, i);
+    std::vector<hash_idx> buckets = mp.query(bucket_hash, i);
 
     // Assert
     for (auto& bucket : buckets) {
@@ -102,3 +103,113 @@ TEST(LSHHashMapTest, QueryReturnsCorrectHammingDistanceOfBucketId)
     }
   }
 }
+
+// Access
+TEST(LSHHashMapTest, AccessReturnsEmptyViewForEmptyBucket)
+{
+  // Arrange
+  LSHHashMap<D> mp(H);
+  mp.add(Point<D>(0b101));
+
+  // Act
+  bucket_view empty = mp[mp.hash(Point<D>(0b010))],
+              filled = mp[mp.hash(Point<D>(0b101))];
+
+  // Assert
+  ASSERT_TRUE(empty.empty());
+  ASSERT_EQ(filled.size(), 1);
+  ASSERT_EQ(filled.front(), 0);
+}
+
+// Deep chains
+TEST(LSHHashMapTest, ChainsDeeperThan32UseFullBucketKeys)
+{
+  // Arrange : a chain of 48 single-bit hashes, and points differing only above bit 32
+  constexpr ui32 DEPTH = 48;
+  HashFamily<64> hf;
+  for (ui32 i = 0; i < DEPTH; ++i) {
+    hf.push_back([i](const Point<64>& p) { return p[i]; });
+  }
+  BucketMask masks(DEPTH, 1U);
+  LSHMap<64>* mp = make_lsh_hash_map<64>(hf, masks);
+  const Point<64> a(1ULL << 40), b((1ULL << 40) | (1ULL << 47));
+
+  // Act
+  mp->add(a);
+  mp->add(b);
+
+  // Assert
+  ASSERT_EQ(mp->bucketCount(), 1ULL << DEPTH);
+  ASSERT_EQ(mp->hash(b), (1ULL << 40) | (1ULL << 47));
+  ASSERT_EQ((*mp)[mp->hash(a)].size(), 1);
+  ASSERT_EQ((*mp)[mp->hash(b)].front(), 1);
+
+  // The bucket of b is a neighbour of the bucket of a at hamming distance 1
+  auto neighbours = mp->query(mp->hash(a), 1);
+  ASSERT_EQ(neighbours.size(), DEPTH);
+  ASSERT_NE(std::find(ALL(neighbours), mp->hash(b)), neighbours.end());
+  delete mp;
+}
+
+TEST(LSHHashMapTest, InlinedBucketsCopyTheirPointsInBucketOrder)
+{
+  // Arrange : buckets of 1 and 3 points
+  std::vector<Point<D>> input = {
+      Point<D>(0b0001),
+      Point<D>(0b0110),
+      Point<D>(0b0110),
+      Point<D>(0b0110),
+  };
+  LSHHashMap<D> mp(H);
+  mp.add(input);
+  const hash_idx small = mp.hash(input[0]), large = mp.hash(input[1]);
+
+  // Act
+  mp.inline_points(input, 2);
+
+  // Assert : only the large bucket is inlined, aligned with its ids
+  ASSERT_TRUE(mp.inlined(small).empty());
+  auto sketches = mp.inlined(large);
+  ASSERT_EQ(sketches.size(), mp[large].size());
+  for (ui32 i = 0; i < sketches.size(); ++i) {
+    ASSERT_EQ(sketches[i], input[mp[large][i]]);
+  }
+  ASSERT_EQ(mp.inlined_bytes(), 3 * sizeof(Point<D>));
+
+  // Assert : adding a point drops the stale copies
+  mp.add(input[1]);
+  ASSERT_TRUE(mp.inlined(large).empty());
+  ASSERT_EQ(mp.inlined_bytes(), 0);
+}
+
+TEST(LSHHashMapTest, BucketSummariesBoundTheDistanceToEveryPoint)
+{
+  // Arrange : a bucket of 0b0110 and 0b0111, the bits of H only depend on the lowest dimensions
+  std::vector<Point<D>> input = {
+      Point<D>(0b0110),
+      Point<D>(0b0111),
+      Point<D>(0b0001),
+  };
+  LSHHashMap<D> mp(H);
+  mp.add(input);
+
+  // Act
+  mp.summarize_buckets(input, 1);
+
+  // Assert : the members agree on bits 1-3, of which a query of 0b1000 differs in all three
+  for (ui32 i = 0; i < input.size(); ++i) {
+    const BucketSummary<D>* summary = mp.summary(mp.hash(input[i]));
+    ASSERT_NE(summary, nullptr);
+    for (ui32 q = 0; q < (1U << D); ++q) {
+      for (auto pidx : mp[mp.hash(input[i])]) {
+        ASSERT_LE(summary->lower_bound(Point<D>(q)), Point<D>(q).distance(input[pidx]));
+      }
+    }
+  }
+  ASSERT_EQ(mp.summary(mp.hash(input[0]))->lower_bound(Point<D>(0b1000)), 3);
+
+  // Assert : adding a point drops the stale summaries
+  mp.add(input[0]);
+  ASSERT_EQ(mp.summary(mp.hash(input[0])), nullptr);
+  ASSERT_EQ(mp.summary_bytes(), 0);
+}
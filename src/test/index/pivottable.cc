@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "../../index/pivottable.hpp"
+
+constexpr ui32 DIM = 1024;
+
+TEST(PivotTable, SelectsDistinctSpreadOutPivots) {
+  // Arrange : 4 clusters of identical points
+  std::vector<Point<DIM>> centers, points;
+  for (ui32 c = 0; c < 4; ++c) centers.push_back(Point<DIM>::random());
+  for (ui32 i = 0; i < 400; ++i) points.push_back(centers[i % 4]);
+
+  // Act
+  auto pivots = PivotTable<DIM>::select_pivots(points, 8);
+
+  // Assert : one pivot per cluster, since every further point is a copy of a pivot
+  ASSERT_EQ(pivots.size(), 4);
+  for (auto& c : centers) ASSERT_NE(std::find(ALL(pivots), c), pivots.end());
+}
+
+TEST(PivotTable, LowerBoundIsAtMostTheDistance) {
+  // Arrange
+  std::vector<Point<DIM>> points;
+  for (ui32 i = 0; i < 200; ++i) points.push_back(Point<DIM>::random(i % 2 ? 0.5 : 0.2));
+  PivotTable<DIM> table(PivotTable<DIM>::select_pivots(points, PivotTable<DIM>::DEFAULT_PIVOTS));
+
+  // Act
+  table.assign(points);
+
+  // Assert
+  ASSERT_EQ(table.count(), PivotTable<DIM>::DEFAULT_PIVOTS);
+  ASSERT_EQ(table.size(), points.size());
+  ASSERT_EQ(table.bytes(), points.size() * table.count() * sizeof(ui16));
+  const auto q = table.project(points[0]);
+  ASSERT_EQ(table.lower_bound(q, 0), 0);
+  ui32 positive = 0;
+  for (ui32 i = 1; i < points.size(); ++i) {
+    ASSERT_LE(table.lower_bound(q, i), points[0].distance(points[i]));
+    positive += table.lower_bound(q, i) > 0;
+  }
+  ASSERT_GT(positive, 0);
+}
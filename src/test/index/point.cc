@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+#include "../../index/point.hpp"
+
+template<ui32 DIM>
+static void assertDistanceMatchesBitsetCount() {
+  for (ui32 i = 0; i < 100; ++i) {
+    const auto a = Point<DIM>::random(0.5), b = Point<DIM>::random(0.3);
+    ASSERT_EQ(a.distance(b), (a ^ b).count());
+  }
+}
+
+TEST(PointDistance, UnrolledDistanceMatchesBitsetCount) {
+  static_assert(Point<256>::HAS_WORDS && Point<512>::HAS_WORDS && Point<1024>::HAS_WORDS);
+  assertDistanceMatchesBitsetCount<256>();
+  assertDistanceMatchesBitsetCount<512>();
+  assertDistanceMatchesBitsetCount<1024>();
+  assertDistanceMatchesBitsetCount<100>();
+}
+
+template<ui32 DIM>
+static void assertBoundedDistanceIsExactBelowBound() {
+  for (ui32 i = 0; i < 100; ++i) {
+    const auto a = Point<DIM>::random(0.5), b = Point<DIM>::random(0.3);
+    const ui32 dist = a.distance(b);
+    for (ui32 bound : { 0U, dist / 4, dist, dist + 1, DIM, UINT32_MAX }) {
+      if (dist < bound) ASSERT_EQ(a.distance_bounded(b, bound), dist);
+      else              ASSERT_GE(a.distance_bounded(b, bound), bound);
+    }
+  }
+}
+
+TEST(PointDistance, BoundedDistanceIsExactBelowBound) {
+  assertBoundedDistanceIsExactBelowBound<256>();
+  assertBoundedDistanceIsExactBelowBound<1024>();
+  assertBoundedDistanceIsExactBelowBound<100>();
+}
+
+TEST(PointWords, FromWordsMatchesConcatenatedBitstring) {
+  // Arrange : the sketch files store the most significant word first
+  const std::vector<ui64> in = { 0x8000000000000001ULL, 0x00000000FFFFFFFFULL, 0xDEADBEEFULL, 0x1ULL };
+  std::stringstream ss;
+  for (auto w : in) ss << std::bitset<64>(w);
+
+  // Act
+  const auto p = Point<256>::from_words(in);
+
+  // Assert
+  ASSERT_EQ(p, Point<256>(ss.str()));
+  ASSERT_EQ(p.words()[0], 0x1ULL);
+  ASSERT_EQ(p.words()[3], 0x8000000000000001ULL);
+  ASSERT_EQ(Point<128>::from_words(std::vector<ui64>{ 0x2ULL, 0x1ULL }), (Point<128>(0x2ULL) << 64) | Point<128>(0x1ULL));
+}
@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+
+#include "../../index/pointstore.hpp"
+
+constexpr ui32 DIM = 256;
+
+static std::vector<Point<DIM>> createPoints(ui32 n) {
+  std::vector<Point<DIM>> ret;
+  for (ui32 i = 0; i < n; ++i) ret.push_back(Point<DIM>::random());
+  return ret;
+}
+
+TEST(PointStore, CopiesPointsIntoAlignedMemory) {
+  // Arrange
+  auto points = createPoints(100);
+
+  // Act
+  PointStore<DIM> store(points);
+
+  // Assert
+  ASSERT_EQ(store.size(), points.size());
+  ASSERT_EQ((uintptr_t) store.data() % 64, 0);
+  ASSERT_FALSE(store.borrowed());
+  ASSERT_TRUE(std::equal(ALL(store), points.begin()));
+}
+
+TEST(PointStore, PushBackKeepsPointsWhenGrowing) {
+  PointStore<DIM> store;
+  auto points = createPoints(1000);
+  for (auto& p : points) store.push_back(p);
+
+  ASSERT_EQ(store.size(), points.size());
+  ASSERT_GE(store.capacity(), points.size());
+  ASSERT_TRUE(std::equal(ALL(store), points.begin()));
+}
+
+TEST(PointStore, BorrowsExternalWordsWithoutCopying) {
+  // Arrange
+  std::vector<ui64> words(3 * Point<DIM>::WORDS);
+  for (ui32 i = 0; i < words.size(); ++i) words[i] = i * 0x9E3779B97F4A7C15ULL;
+
+  // Act
+  PointStore<DIM> store(words);
+
+  // Assert
+  ASSERT_TRUE(store.borrowed());
+  ASSERT_EQ(store.size(), 3);
+  ASSERT_EQ((const void*) store.data(), (const void*) words.data());
+  ASSERT_EQ(store[1].words()[0], words[Point<DIM>::WORDS]);
+
+  // Adding a point moves the store into owned memory
+  const Point<DIM> p = Point<DIM>::random();
+  store.push_back(p);
+  ASSERT_FALSE(store.borrowed());
+  ASSERT_EQ(store.size(), 4);
+  ASSERT_EQ(store[1].words()[0], words[Point<DIM>::WORDS]);
+  ASSERT_EQ(store[3], p);
+}
+
+TEST(PointStore, BorrowedRowsInReversedWordOrderMatchFromWords) {
+  // Arrange, rows of a dataset hold the most significant word first
+  const ui32 W = Point<DIM>::WORDS;
+  std::vector<ui64> rows(2 * W);
+  for (ui32 i = 0; i < rows.size(); ++i) rows[i] = i * 0x9E3779B97F4A7C15ULL;
+  std::vector<ui64> words(rows);
+  for (ui32 r = 0; r < 2; ++r) std::reverse(words.begin() + r * W, words.begin() + (r + 1) * W);
+
+  // Act
+  PointStore<DIM> store(words);
+
+  // Assert
+  for (ui32 r = 0; r < 2; ++r) {
+    ASSERT_EQ(store[r], Point<DIM>::from_words(std::span<const ui64>(&rows[r * W], W)));
+  }
+}
+
+TEST(PointStore, HugePageStoresArePrefaultedAndLockedBestEffort) {
+  // Arrange : a store spanning several huge pages
+  const ui32 N = 4 * PointStore<DIM>::HUGE_PAGE_BYTES / sizeof(Point<DIM>);
+  auto points = createPoints(1024);
+
+  // Act
+  PointStore<DIM> store(PointStoreConfig{ .huge_pages = true, .lock = true, .prefault = true });
+  store.reserve(N);
+  for (ui32 i = 0; i < N; ++i) store.push_back(points[i % points.size()]);
+
+  // Assert : huge pages and locking depend on the system, but never change the contents
+  ASSERT_EQ(store.capacity(), N);
+  ASSERT_EQ(store.size(), N);
+  for (ui32 i = 0; i < N; i += 997) ASSERT_EQ(store[i], points[i % points.size()]);
+}
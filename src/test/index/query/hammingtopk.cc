@@ -0,0 +1,68 @@
+#include <gtest/gtest.h>
+#include <random>
+
+#include "../../../index/query/hammingtopk.hpp"
+
+constexpr ui32 TOPK_D = 64;
+
+// Returns the expected k nearest indices by sorting all pairs
+static std::vector<ui32> expected_k_nearest(std::vector<std::pair<ui32, ui32>> pairs, ui32 k) {
+  std::sort(ALL(pairs));
+  std::vector<ui32> ret;
+  for (ui32 i = 0; i < std::min(k, (ui32) pairs.size()); ++i) {
+    ret.push_back(pairs[i].second);
+  }
+  return ret;
+}
+
+TEST(HammingTopK, Get_kth_dist_ReturnsUINTMAX_If_Empty) {
+  for (ui32 k : {1U, 10U, HammingTopK<TOPK_D>::SMALL_K, 100U}) {
+    HammingTopK<TOPK_D> topk(k);
+    ASSERT_EQ(topk.get_kth_dist(), UINT32_MAX);
+    ASSERT_EQ(topk.threshold(), UINT32_MAX);
+  }
+}
+
+TEST(HammingTopK, Threshold_IsKthDistanceWhenFull) {
+  for (ui32 k : {4U, 100U}) {
+    HammingTopK<TOPK_D> topk(k);
+    for (ui32 i = 0; i < k; ++i) {
+      ASSERT_EQ(topk.threshold(), UINT32_MAX);
+      topk.insert(i % TOPK_D, i);
+    }
+    ASSERT_EQ(topk.threshold(), topk.get_kth_dist());
+    ASSERT_FALSE(topk.insert(topk.get_kth_dist(), k));
+  }
+}
+
+TEST(HammingTopK, Extract_ReturnsKNearestInAscendingOrder) {
+  std::mt19937 gen(42);
+  std::uniform_int_distribution<ui32> dist(0, TOPK_D);
+
+  for (ui32 k : {1U, 7U, HammingTopK<TOPK_D>::SMALL_K, HammingTopK<TOPK_D>::SMALL_K + 1, 100U}) {
+    std::vector<std::pair<ui32, ui32>> pairs;
+    HammingTopK<TOPK_D> topk(k);
+    for (ui32 i = 0; i < 2000; ++i) {
+      pairs.emplace_back(dist(gen), i);
+      topk.insert(pairs.back().first, i);
+    }
+
+    auto exp = expected_k_nearest(pairs, k);
+    ASSERT_EQ(topk.get_kth_dist(), pairs[exp.back()].first);
+
+    auto act = topk.extract();
+    ASSERT_EQ(act, exp) << "Mismatch for k=" << k;
+  }
+}
+
+TEST(HammingTopK, Extract_ReturnsUpToK) {
+  for (ui32 k : {10U, 100U}) {
+    HammingTopK<TOPK_D> topk(k);
+    for (ui32 i = 0; i < k / 2; ++i) {
+      topk.insert(TOPK_D - i, i);
+    }
+    ASSERT_EQ(topk.size(), k / 2);
+    ASSERT_EQ(topk.get_kth_dist(), TOPK_D);
+    ASSERT_EQ(topk.extract().size(), k / 2);
+  }
+}
@@ -117,3 +117,25 @@ TEST(PointMap, Contains_TrueIfContained_FalseIfNot) {
     ASSERT_TRUE(mp.contains(pidxs[i])) << "Expected point[" << i << "] to be contained, but it was not";
   }
 }
+
+TEST(PointMap, InsertWithPointAdmitsTheSamePointsAsInsertByIndex) {
+  // Arrange : a lossy short sketch prefilter
+  constexpr ui32 DIM = 64;
+  std::vector<Point<DIM>> points;
+  for (ui32 i = 0; i < 500; ++i) points.push_back(Point<DIM>::random());
+  const Point<DIM> q = Point<DIM>::random();
+  ShortSketches<DIM> shorts(ShortSketches<DIM>::select_dims(points, 8));
+  shorts.assign(points);
+
+  PointMap<DIM> by_index(points, q, 10), with_point(points, q, 10);
+  by_index.set_prefilter(&shorts, 0.0f);
+  with_point.set_prefilter(&shorts, 0.0f);
+
+  // Act
+  for (ui32 i = 0; i < points.size(); ++i) {
+    ASSERT_EQ(by_index.insert(i), with_point.insert(i, points[i]));
+  }
+
+  // Assert
+  ASSERT_EQ(by_index.extract_k_nearest(), with_point.extract_k_nearest());
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "../util.hpp"
+#include "../../../index/lsharraymap.hpp"
+#include "../../../index/query/probecursor.hpp"
+
+TEST(ProbeCursor, VisitsBucketsInAscendingHammingDistance) {
+  // Arrange
+  LSHArrayMap<D> mp(H);
+  auto points = createCompleteInput();
+  mp.add(points);
+  const Point<D> query(0b0101);
+  const hash_idx hash = mp.hash(query);
+
+  ProbeCursor<D> cursor;
+  cursor.start(&mp, query, hash);
+
+  // Act : Scan every bucket one point at a time
+  std::vector<ui32> seen;
+  ui32 last_dist = 0;
+  while (!cursor.exhausted()) {
+    if (cursor.remaining()) {
+      const ui32 pidx = cursor.bucket[cursor.offset];
+      seen.push_back(pidx);
+      // Assert : each bucket holds a single point of the complete input
+      ASSERT_GE(query.distance(points[pidx]), last_dist);
+      last_dist = query.distance(points[pidx]);
+    }
+    cursor.consume(std::min(1U, cursor.remaining()), 1);
+  }
+
+  // Assert : Every bucket below the depth of the map was visited once
+  std::sort(ALL(seen));
+  ASSERT_EQ(std::unique(ALL(seen)), seen.end());
+  ASSERT_EQ(seen.size(), points.size() - 1);
+  ASSERT_EQ(cursor.probes, (1U << D) - 1);
+}
+
+TEST(ProbeCursor, CountsScannedAndAdmittedPoints) {
+  LSHArrayMap<D> mp(H);
+  auto points = createCompleteInput();
+  mp.add(points);
+  mp.add(points);
+
+  ProbeCursor<D> cursor;
+  cursor.start(&mp, Point<D>(0), 0);
+  ASSERT_EQ(cursor.remaining(), 2);
+
+  ASSERT_FALSE(cursor.consume(1, 1));
+  ASSERT_TRUE(cursor.consume(1, 0));
+  ASSERT_EQ(cursor.scanned, 2);
+  ASSERT_EQ(cursor.admitted, 1);
+  ASSERT_EQ(cursor.hdist, 1);
+}
+
+TEST(ProbeCursor, DirectedCursorVisitsBucketsInAscendingFlipScore) {
+  // Arrange : bit i of the hash costs i+1 to flip, independently of the point
+  HashFamily<D> hf;
+  for (ui32 i = 0; i < D; ++i) {
+    hf.push_back([i](const Point<D>& p) { return p[i]; },
+                 { i, [i](const Point<D>& p) { return (p[i] ? 1.0f : -1.0f) * (i + 1); } });
+  }
+  LSHArrayMap<D> mp(hf);
+  auto points = createCompleteInput();
+  mp.add(points);
+  const Point<D> query(0b0000);
+
+  ProbeCursor<D> cursor;
+  cursor.start(&mp, query, mp.hash(query));
+  ASSERT_TRUE(cursor.directed);
+
+  // Act : Scan every bucket one point at a time
+  std::vector<ui32> seen;
+  ui32 last_score = 0;
+  while (!cursor.exhausted()) {
+    if (cursor.remaining()) {
+      const ui32 pidx = cursor.bucket[cursor.offset];
+      seen.push_back(pidx);
+      // Assert : the score of a bucket is the sum of the flipped bits' costs
+      ui32 score = 0;
+      for (ui32 i = 0; i < D; ++i) score += points[pidx][i] ? i + 1 : 0;
+      ASSERT_GE(score, last_score);
+      last_score = score;
+    }
+    cursor.consume(std::min(1U, cursor.remaining()), 1);
+  }
+
+  // Assert : Every bucket differing in less than D bits was visited once
+  std::sort(ALL(seen));
+  ASSERT_EQ(std::unique(ALL(seen)), seen.end());
+  ASSERT_EQ(seen.size(), points.size() - 1);
+}
+
+TEST(ProbeCursor, LocateScoresTheBitsOfTheHash) {
+  // Arrange
+  HashFamily<D> hf;
+  for (ui32 i = 0; i < D; ++i) {
+    hf.push_back([i](const Point<D>& p) { return p[i]; },
+                 { i, [i](const Point<D>& p) { return (p[i] ? 1.0f : -1.0f) * (D - i); } });
+  }
+  LSHArrayMap<D> mp(hf);
+  mp.add(createCompleteInput());
+  const Point<D> query(0b0101);
+
+  // Act
+  ProbeCursor<D> located, started;
+  const hash_idx hash = located.locate(&mp, query);
+  located.start(&mp, query, hash, true);
+  started.start(&mp, query, mp.hash(query));
+
+  // Assert : both cursors walk the same buckets
+  ASSERT_EQ(hash, mp.hash(query));
+  ASSERT_EQ(located.flips, started.flips);
+  while (!started.exhausted()) {
+    ASSERT_FALSE(located.exhausted());
+    ASSERT_EQ(located.bucket.data(), started.bucket.data());
+    located.next_bucket();
+    started.next_bucket();
+  }
+  ASSERT_TRUE(located.exhausted());
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include <set>
+
+#include "../util.hpp"
+#include "../../../index/query/probesequence.hpp"
+
+TEST(ProbeSequence, GeneratesEveryPerturbationOnceInAscendingScore) {
+  // Arrange
+  const std::vector<float> scores = { 0.5f, 3.0f, 1.25f, 0.1f, 2.0f, 1.0f };
+  const ui32 max_flips = 3;
+  ProbeSequence seq;
+  seq.reset(scores, max_flips);
+
+  // Act
+  std::set<ui64> masks;
+  float last_score = 0.0f;
+  ui64 mask;
+  ui32 flips;
+  while (seq.next(mask, flips)) {
+    float score = 0.0f;
+    for (ui32 i = 0; i < scores.size(); ++i) {
+      if (mask & (1ULL << i)) score += scores[i];
+    }
+
+    // Assert
+    ASSERT_EQ(std::popcount(mask), flips);
+    ASSERT_LE(flips, max_flips);
+    ASSERT_GE(score + 1e-6f, last_score);
+    ASSERT_TRUE(masks.insert(mask).second) << "mask " << mask << " generated twice";
+    last_score = score;
+  }
+
+  // Every subset of at most 3 bits : 1 + 6 + 15 + 20
+  ASSERT_EQ(masks.size(), 42);
+}
+
+TEST(ProbeSequence, StartsWithTheEmptyMask) {
+  ProbeSequence seq;
+  seq.reset(std::vector<float>{ 2.0f, 1.0f }, 1);
+
+  ui64 mask;
+  ui32 flips;
+  ASSERT_TRUE(seq.next(mask, flips));
+  ASSERT_EQ(mask, 0);
+  ASSERT_TRUE(seq.next(mask, flips));
+  ASSERT_EQ(mask, 0b10);
+  ASSERT_TRUE(seq.next(mask, flips));
+  ASSERT_EQ(mask, 0b01);
+  ASSERT_FALSE(seq.next(mask, flips));
+}
@@ -0,0 +1,95 @@
+#include <gtest/gtest.h>
+
+#include "../../../index/query/querycache.hpp"
+
+constexpr ui32 CACHE_D = 64;
+
+static QueryCacheConfig single_shard(ui32 capacity, ui32 near_distance = 0) {
+  QueryCacheConfig config;
+  config.capacity = capacity;
+  config.near_distance = near_distance;
+  config.shards = 1;
+  return config;
+}
+
+TEST(QueryCache, LookupReturnsInsertedResult) {
+  // Arrange
+  QueryCache<CACHE_D> cache(single_shard(4));
+  Point<CACHE_D> q(0xF0F0);
+  cache.insert(q, 1, 2, 0.9, { 4, 2 });
+
+  // Act & Assert
+  ASSERT_EQ(cache.lookup(q, 1, 2, 0.9), std::vector<ui32>({ 4, 2 }));
+  ASSERT_FALSE(cache.lookup(q, 1, 3, 0.9).has_value());
+  ASSERT_FALSE(cache.lookup(q, 1, 2, 0.8).has_value());
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(0xF0F1), 1, 2, 0.9).has_value());
+  ASSERT_FALSE(cache.lookup(q, 1, 2, 0.9, 1).has_value()) << "Results of another path are never returned";
+
+  auto stats = cache.stats();
+  ASSERT_EQ(stats.hits, 1);
+  ASSERT_EQ(stats.misses, 4);
+  ASSERT_EQ(stats.entries, 1);
+}
+
+TEST(QueryCache, EvictsLeastRecentlyUsed) {
+  // Arrange
+  QueryCache<CACHE_D> cache(single_shard(2));
+  cache.insert(Point<CACHE_D>(1), 0, 1, 0.9, { 1 });
+  cache.insert(Point<CACHE_D>(2), 0, 1, 0.9, { 2 });
+
+  // Act : touch 1, such that 2 is the least recently used
+  ASSERT_TRUE(cache.lookup(Point<CACHE_D>(1), 0, 1, 0.9).has_value());
+  cache.insert(Point<CACHE_D>(3), 0, 1, 0.9, { 3 });
+
+  // Assert
+  ASSERT_TRUE(cache.lookup(Point<CACHE_D>(1), 0, 1, 0.9).has_value());
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(2), 0, 1, 0.9).has_value());
+  ASSERT_TRUE(cache.lookup(Point<CACHE_D>(3), 0, 1, 0.9).has_value());
+  ASSERT_EQ(cache.stats().entries, 2);
+}
+
+TEST(QueryCache, NearDuplicateInSameBucketIsAHit) {
+  // Arrange
+  QueryCache<CACHE_D> cache(single_shard(4, 2));
+  cache.insert(Point<CACHE_D>(0b0000), 7, 1, 0.9, { 1 });
+  cache.insert(Point<CACHE_D>(0b1111), 7, 1, 0.9, { 2 });
+
+  // Act & Assert
+  ASSERT_EQ(cache.lookup(Point<CACHE_D>(0b0001), 7, 1, 0.9), std::vector<ui32>({ 1 }));
+  ASSERT_EQ(cache.lookup(Point<CACHE_D>(0b1110), 7, 1, 0.9), std::vector<ui32>({ 2 }));
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(0b0001), 6, 1, 0.9).has_value());
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(0b111000), 7, 1, 0.9).has_value());
+  ASSERT_EQ(cache.stats().near_hits, 2);
+}
+
+TEST(QueryCache, InvalidateHidesCachedResults) {
+  // Arrange
+  QueryCache<CACHE_D> cache(single_shard(4, 2));
+  cache.insert(Point<CACHE_D>(1), 0, 1, 0.9, { 1 });
+
+  // Act
+  cache.invalidate();
+
+  // Assert
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(1), 0, 1, 0.9).has_value());
+  ASSERT_FALSE(cache.lookup(Point<CACHE_D>(3), 0, 1, 0.9).has_value());
+  ASSERT_EQ(cache.stats().entries, 0);
+}
+
+TEST(QueryCache, RespectsMemoryLimit) {
+  // Arrange
+  QueryCacheConfig config = single_shard(1000);
+  config.max_bytes = 4096;
+  QueryCache<CACHE_D> cache(config);
+
+  // Act
+  for (ui32 i = 0; i < 100; ++i) {
+    cache.insert(Point<CACHE_D>(i), 0, 100, 0.9, std::vector<ui32>(100, i));
+  }
+
+  // Assert
+  auto stats = cache.stats();
+  ASSERT_LE(stats.bytes, config.max_bytes);
+  ASSERT_LT(stats.entries, 100);
+  ASSERT_TRUE(cache.lookup(Point<CACHE_D>(99), 0, 100, 0.9).has_value());
+}
@@ -0,0 +1,32 @@
+#include <gtest/gtest.h>
+
+#include "../util.hpp"
+#include "../../../index/lsharraymap.hpp"
+#include "../../../index/query/queryorder.hpp"
+
+TEST(QueryOrdering, InterleavePlacesBitsOfFirstKeyAtEvenPositions) {
+  ASSERT_EQ(QueryOrdering::interleave(0b11, 0b00), 0b0101);
+  ASSERT_EQ(QueryOrdering::interleave(0b00, 0b11), 0b1010);
+  ASSERT_EQ(QueryOrdering::interleave(UINT32_MAX, UINT32_MAX), UINT64_MAX);
+}
+
+TEST(QueryOrdering, GrayRankInvertsGrayCode) {
+  for (ui64 i = 0; i < 1024; ++i) {
+    ASSERT_EQ(QueryOrdering::gray_rank(i ^ (i >> 1)), i);
+  }
+}
+
+TEST(QueryOrdering, PermutationGroupsQueriesByKey) {
+  // Arrange
+  LSHArrayMap<D> mp(H);
+  std::vector<LSHMap<D>*> maps { &mp };
+  std::vector<Point<D>> queries { Point<D>(3), Point<D>(1), Point<D>(3), Point<D>(0), Point<D>(1) };
+
+  // Act
+  auto input = QueryOrdering::permutation(queries, maps, QueryOrder::Input);
+  auto by_key = QueryOrdering::permutation(queries, maps, QueryOrder::MapKey);
+
+  // Assert
+  ASSERT_EQ(input, std::vector<ui32>({ 0, 1, 2, 3, 4 }));
+  ASSERT_EQ(by_key, std::vector<ui32>({ 3, 1, 4, 0, 2 }));
+}
@@ -0,0 +1,65 @@
+#include <gtest/gtest.h>
+
+#include "../../../index/query/recallcalibration.hpp"
+
+TEST(RecallCalibration, BudgetIsUINTMAX_If_Empty) {
+  RecallCalibration calibration;
+  ASSERT_TRUE(calibration.empty());
+  ASSERT_EQ(calibration.budget(0.9), UINT32_MAX);
+}
+
+TEST(RecallCalibration, BudgetInterpolatesBetweenCalibratedRecalls) {
+  // Arrange
+  RecallCalibration calibration;
+  calibration.set(0.75, 200);
+  calibration.set(0.5, 100);
+
+  // Act & Assert
+  ASSERT_EQ(calibration.budget(0.25), 100);
+  ASSERT_EQ(calibration.budget(0.5), 100);
+  ASSERT_EQ(calibration.budget(0.625), 150);
+  ASSERT_EQ(calibration.budget(0.75), 200);
+  ASSERT_EQ(calibration.budget(0.875), UINT32_MAX);
+}
+
+TEST(RecallCalibration, FitChoosesSmallestBudgetMeetingRecall) {
+  // Arrange
+  std::vector<std::pair<ui32, std::vector<float>>> measurements = {
+    { 10, { 0.5, 0.6, 0.7 } },
+    { 20, { 0.8, 0.8, 0.8 } },
+    { 40, { 0.9, 1.0, 0.95 } },
+  };
+
+  // Act
+  auto calibration = RecallCalibration::fit(measurements, { 0.6, 0.8, 0.9, 0.99 }, 0.0);
+
+  // Assert
+  ASSERT_EQ(calibration.budget(0.6), 10);
+  ASSERT_EQ(calibration.budget(0.8), 20);
+  ASSERT_EQ(calibration.budget(0.9), 40);
+  ASSERT_EQ(calibration.entries().size(), 3) << "0.99 is never reached and should be left out";
+}
+
+TEST(RecallCalibration, FitRequiresConfidenceBound) {
+  // Arrange : The mean meets the recall, but not the confidence bound
+  std::vector<std::pair<ui32, std::vector<float>>> measurements = {
+    { 10, { 0.6, 1.0 } },
+    { 20, { 0.8, 0.8 } },
+  };
+
+  // Act
+  auto calibration = RecallCalibration::fit(measurements, { 0.8 });
+
+  // Assert
+  ASSERT_EQ(calibration.budget(0.8), 20);
+}
+
+TEST(RecallCalibration, BudgetOnlyAppliesToTheCalibratedK) {
+  RecallCalibration calibration;
+  calibration.set(0.9, 100);
+  ASSERT_EQ(calibration.budget(0.9, 10), 100) << "An unkeyed table applies to every k";
+
+  calibration.set_k(10);
+  ASSERT_EQ(calibration.budget(0.9, 10), 100);
+  ASSERT_EQ(calibration.budget(0.9, 20), UINT32_MAX);
+}
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include "../../index/shortsketches.hpp"
+
+constexpr ui32 DIM = 1024;
+
+TEST(ShortSketches, SelectsTheMostBalancedDimensions) {
+  // Arrange : the first half of the dimensions is constant, the second half random
+  std::vector<Point<DIM>> points;
+  for (ui32 i = 0; i < 1000; ++i) {
+    Point<DIM> p = Point<DIM>::random();
+    for (ui32 d = 0; d < DIM / 2; ++d) p[d] = d % 2;
+    points.push_back(p);
+  }
+
+  // Act
+  auto dims = ShortSketches<DIM>::select_dims(points, 128);
+
+  // Assert
+  ASSERT_EQ(dims.size(), 128);
+  ASSERT_TRUE(std::is_sorted(ALL(dims)));
+  for (auto d : dims) ASSERT_GE(d, DIM / 2);
+}
+
+TEST(ShortSketches, ShortDistanceIsALowerBoundOfTheDistance) {
+  // Arrange
+  std::vector<Point<DIM>> points;
+  for (ui32 i = 0; i < 100; ++i) points.push_back(Point<DIM>::random());
+
+  for (ui32 bits : { 100U, 128U, 256U }) {
+    ShortSketches<DIM> shorts(ShortSketches<DIM>::select_dims(points, bits));
+
+    // Act
+    shorts.assign(points);
+
+    // Assert
+    ASSERT_EQ(shorts.size(), points.size());
+    ASSERT_EQ(shorts.bytes(), points.size() * ((bits + 63) / 64) * sizeof(ui64));
+    const auto q = shorts.project(points[0]);
+    ASSERT_EQ(shorts.distance(q, 0), 0);
+    for (ui32 i = 1; i < points.size(); ++i) {
+      ASSERT_LE(shorts.distance(q, i), points[0].distance(points[i]));
+      ASSERT_GT(shorts.distance(q, i), 0);
+    }
+  }
+}
@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include "../../util/ringbuffer.hpp"
+
+TEST(RingBuffer, ResetRoundsCapacityUpToPowerOfTwo) {
+  RingBuffer<ui32> q(5);
+  ASSERT_EQ(q.capacity(), 8);
+  ASSERT_TRUE(q.empty());
+
+  q.reset(3);
+  ASSERT_EQ(q.capacity(), 8);
+}
+
+TEST(RingBuffer, PopsInInsertionOrderAcrossWrapAround) {
+  RingBuffer<ui32> q(4);
+  ui32 next = 0;
+  for (ui32 i = 0; i < 100; ++i) {
+    q.push(i);
+    if (q.size() == 3) {
+      ASSERT_EQ(q.front(), next++);
+      q.pop();
+    }
+  }
+
+  ASSERT_EQ(q.size(), 2);
+  while (!q.empty()) {
+    ASSERT_EQ(q.front(), next++);
+    q.pop();
+  }
+  ASSERT_EQ(next, 100);
+}
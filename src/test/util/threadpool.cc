@@ -0,0 +1,77 @@
+#include <gtest/gtest.h>
+
+#include "../../util/threadpool.hpp"
+
+TEST(ThreadPool, ParallelForVisitsEveryIndexOnce) {
+  // Arrange
+  ThreadPool pool(4);
+  const ui32 N = 10000;
+  std::vector<std::atomic<ui32>> visits(N);
+
+  // Act
+  pool.parallel_for(0, N, 7, [&visits](ui32 i) { ++visits[i]; });
+
+  // Assert
+  for (ui32 i = 0; i < N; ++i) {
+    ASSERT_EQ(visits[i].load(), 1) << "Index " << i << " was visited " << visits[i].load() << " times";
+  }
+}
+
+TEST(ThreadPool, ParallelChunksCoversRange) {
+  // Arrange
+  ThreadPool pool(3);
+  std::atomic<ui64> sum(0);
+
+  // Act
+  pool.parallel_chunks(10, 1010, 0, [&sum](ui32 lo, ui32 hi) {
+    for (ui32 i = lo; i < hi; ++i) sum += i;
+  });
+
+  // Assert
+  ASSERT_EQ(sum.load(), (10ULL + 1009ULL) * 1000ULL / 2ULL);
+}
+
+TEST(ThreadPool, NestedParallelForDoesNotDeadlock) {
+  // Arrange
+  ThreadPool pool(2);
+  std::atomic<ui32> cnt(0);
+
+  // Act
+  pool.parallel_for(0, 8, 1, [&pool, &cnt](ui32) {
+    pool.parallel_for(0, 100, 10, [&cnt](ui32) { ++cnt; });
+  });
+
+  // Assert
+  ASSERT_EQ(cnt.load(), 800);
+}
+
+TEST(ThreadPool, ParallelForRespectsConcurrencyLimit) {
+  // Arrange
+  ThreadPool pool(4);
+  std::atomic<ui32> active(0), most_active(0), cnt(0);
+
+  // Act
+  pool.parallel_for(0, 64, 1, [&](ui32) {
+    const ui32 now = ++active;
+    ui32 prev = most_active.load();
+    while (prev < now && !most_active.compare_exchange_weak(prev, now));
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    ++cnt;
+    --active;
+  }, 2);
+
+  // Assert
+  ASSERT_EQ(cnt.load(), 64);
+  ASSERT_LE(most_active.load(), 2);
+}
+
+TEST(ThreadPool, DestructorFinishesSubmittedTasks) {
+  std::atomic<ui32> cnt(0);
+  {
+    ThreadPool pool(2);
+    for (ui32 i = 0; i < 100; ++i) {
+      pool.submit([&cnt]() { ++cnt; });
+    }
+  }
+  ASSERT_EQ(cnt.load(), 100);
+}
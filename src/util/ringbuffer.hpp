@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../global.hpp"
+
+/**
+ * @brief A FIFO queue over a reusable power-of-two sized buffer.
+ *        Unlike std::queue, the buffer is kept between uses, such that a queue
+ *        reset to the same capacity never allocates.
+ * @tparam T type of the elements in the queue
+ */
+template<typename T>
+class RingBuffer {
+  std::vector<T> buffer;
+  ui32 head = 0, count = 0;
+
+  inline ui32 mask() const noexcept { return buffer.size() - 1; }
+
+public:
+  RingBuffer(ui32 capacity = 0) { this->reset(capacity); }
+
+  /**
+   * @brief Empties the queue and ensures that it can hold @capacity elements
+   */
+  void reset(ui32 capacity) {
+    ui32 size = 1;
+    while (size < capacity) size <<= 1;
+    if (buffer.size() < size) buffer.resize(size);
+    head = count = 0;
+  }
+
+  inline ui32 size() const noexcept { return count; }
+
+  inline bool empty() const noexcept { return count == 0; }
+
+  inline ui32 capacity() const noexcept { return buffer.size(); }
+
+  inline T& front() noexcept {
+    assert(!this->empty());
+    return buffer[head];
+  }
+
+  inline void push(T value) noexcept {
+    assert(count < buffer.size());
+    buffer[(head + count) & mask()] = std::move(value);
+    ++count;
+  }
+
+  template<typename... Args>
+  inline void emplace(Args&&... args) noexcept {
+    this->push(T(std::forward<Args>(args)...));
+  }
+
+  inline void pop() noexcept {
+    assert(!this->empty());
+    head = (head + 1) & mask();
+    --count;
+  }
+};
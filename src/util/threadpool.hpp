@@ -0,0 +1,218 @@
+#pragma once
+
+#include "../global.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+
+/**
+ * @brief A persistent pool of worker threads with a work-stealing deque per worker.
+ *        Workers pop tasks from the back of their own deque and steal from the front
+ *        of the other deques when their own is empty, such that a few slow tasks
+ *        never hold up the remaining work.
+ *        Threads waiting on parallel work help executing tasks, which makes it
+ *        safe to call parallel_for from within a task.
+ */
+class ThreadPool {
+  using Task = std::function<void()>;
+
+  struct WorkQueue {
+    std::deque<Task> tasks;
+    std::mutex mtx;
+  };
+
+  std::vector<std::unique_ptr<WorkQueue>> queues; // queues[w] : deque of worker w
+  std::vector<std::thread> workers;
+
+  // Number of tasks submitted but not yet taken by a thread
+  std::atomic<ui64> pending;
+
+  // Used for round-robin distribution of tasks submitted from outside the pool
+  std::atomic<ui32> next_queue;
+
+  // Sleeping workers are woken when tasks are submitted or the pool stops
+  std::mutex sleep_mtx;
+  std::condition_variable sleep_cv;
+  bool stopping;
+
+  // Index of the worker running on this thread, or UINT32_MAX if this thread is not a worker of the pool
+  static inline thread_local const ThreadPool* current_pool = nullptr;
+  static inline thread_local ui32 current_worker = UINT32_MAX;
+
+  inline ui32 own_queue() const noexcept {
+    return current_pool == this ? current_worker : UINT32_MAX;
+  }
+
+  /**
+   * @brief Takes a task from the back of queue @q if @own, otherwise from the front
+   */
+  bool take(ui32 q, bool own, Task& task) {
+    WorkQueue& wq = *queues[q];
+    std::unique_lock<std::mutex> lock(wq.mtx);
+    if (wq.tasks.empty()) return false;
+
+    if (own) {
+      task = std::move(wq.tasks.back());
+      wq.tasks.pop_back();
+    } else {
+      task = std::move(wq.tasks.front());
+      wq.tasks.pop_front();
+    }
+    --pending;
+    return true;
+  }
+
+  /**
+   * @brief Takes a task from the own queue of the calling thread, or steals one from another queue
+   * @returns True if a task was found
+   */
+  bool find_task(Task& task) {
+    const ui32 W = queues.size(), self = own_queue();
+    if (self != UINT32_MAX && take(self, true, task)) return true;
+
+    const ui32 start = self == UINT32_MAX ? next_queue.load() : self + 1;
+    for (ui32 i = 0; i < W; ++i) {
+      const ui32 victim = (start + i) % W;
+      if (victim != self && take(victim, false, task)) return true;
+    }
+    return false;
+  }
+
+  void work(ui32 id) {
+    current_pool = this;
+    current_worker = id;
+
+    Task task;
+    while (true) {
+      if (find_task(task)) {
+        task();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(sleep_mtx);
+      sleep_cv.wait(lock, [this] { return stopping || pending.load() > 0; });
+      if (stopping && pending.load() == 0) return;
+    }
+  }
+
+public:
+  /**
+   * @param thread_cnt Number of worker threads, defaults to std::thread::hardware_concurrency()
+   */
+  explicit ThreadPool(ui32 thread_cnt = 0) : pending(0), next_queue(0), stopping(false) {
+    if (!thread_cnt) thread_cnt = std::max(1U, std::thread::hardware_concurrency());
+
+    for (ui32 w = 0; w < thread_cnt; ++w) {
+      queues.emplace_back(std::make_unique<WorkQueue>());
+    }
+    for (ui32 w = 0; w < thread_cnt; ++w) {
+      workers.emplace_back(&ThreadPool::work, this, w);
+    }
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /**
+   * @brief Finishes all submitted tasks and joins the workers
+   */
+  ~ThreadPool() {
+    {
+      std::unique_lock<std::mutex> lock(sleep_mtx);
+      stopping = true;
+    }
+    sleep_cv.notify_all();
+    for (auto& th : workers) {
+      th.join();
+    }
+  }
+
+  /**
+   * @brief The pool shared by index build, map optimization and querying.
+   *        It is created on first use with std::thread::hardware_concurrency() workers.
+   */
+  static ThreadPool& instance() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  /**
+   * @returns Number of worker threads in the pool
+   */
+  ui32 size() const noexcept { return workers.size(); }
+
+  /**
+   * @brief Submits a task to the pool. Tasks submitted from a worker are pushed to the back
+   *        of its own deque, other tasks are distributed round-robin between the workers.
+   */
+  void submit(Task task) {
+    ui32 q = own_queue();
+    if (q == UINT32_MAX) q = next_queue++ % queues.size();
+
+    {
+      std::unique_lock<std::mutex> lock(queues[q]->mtx);
+      queues[q]->tasks.push_back(std::move(task));
+      ++pending;
+    }
+    {
+      // Synchronize with workers about to sleep to avoid lost wake-ups
+      std::unique_lock<std::mutex> lock(sleep_mtx);
+    }
+    sleep_cv.notify_one();
+  }
+
+  /**
+   * @brief Splits [beg, end) into chunks of @chunk indices and calls @fn(lo, hi) once for every chunk [lo, hi).
+   *        Returns when all chunks have been processed. The calling thread helps executing tasks while
+   *        there are any and sleeps until the remaining chunks are done otherwise.
+   * @param chunk Number of indices per task, defaults to a size yielding 4 tasks per worker
+   * @param concurrency Largest number of threads processing chunks of this call at the same time, 0 for no limit.
+   *                    The chunks are then claimed one by one by at most @concurrency tasks.
+   */
+  template<typename ChunkFn>
+  void parallel_chunks(ui32 beg, ui32 end, ui32 chunk, ChunkFn fn, ui32 concurrency = 0) {
+    if (beg >= end) return;
+    if (!chunk) chunk = std::max(1U, (end - beg) / (4 * this->size()));
+
+    const ui32 N = (end - beg + chunk - 1) / chunk,
+               T = concurrency ? std::min(N, concurrency) : N;
+    // remaining : number of tasks still running, only decremented while holding done_mtx
+    std::atomic<ui32> next_chunk(0), remaining(T);
+    std::mutex done_mtx;
+    std::condition_variable done_cv;
+
+    for (ui32 t = 0; t < T; ++t) {
+      this->submit([&, beg, end, chunk, N]() {
+        for (ui32 c = next_chunk++; c < N; c = next_chunk++) {
+          const ui32 lo = beg + c * chunk, hi = std::min(lo + chunk, end);
+          fn(lo, hi);
+        }
+        // Decrement and notify under the lock, such that a caller observing the last decrement still
+        // waits for the lock before it returns and destroys done_mtx and done_cv
+        std::lock_guard<std::mutex> lock(done_mtx);
+        if (--remaining == 0) done_cv.notify_all();
+      });
+    }
+
+    // Help out while there is work, then sleep until our chunks are done
+    Task task;
+    while (remaining.load() > 0 && find_task(task)) task();
+
+    std::unique_lock<std::mutex> lock(done_mtx);
+    done_cv.wait(lock, [&remaining] { return remaining.load() == 0; });
+  }
+
+  /**
+   * @brief Calls @fn(i) for every i in [beg, end) on the pool, @chunk indices per task.
+   *        Returns when all calls have finished.
+   * @param concurrency Largest number of threads running calls of @fn at the same time, 0 for no limit
+   */
+  template<typename IndexFn>
+  void parallel_for(ui32 beg, ui32 end, ui32 chunk, IndexFn fn, ui32 concurrency = 0) {
+    this->parallel_chunks(beg, end, chunk, [&fn](ui32 lo, ui32 hi) {
+      for (ui32 i = lo; i < hi; ++i) fn(i);
+    }, concurrency);
+  }
+};